@@ -23,7 +23,7 @@ struct proc_struct {
    char           name[MAXNAME];     /* process's name */
    char           start_arg[MAXARG]; /* args passed to process */
    context        state;             /* current context for process */
-   short          pid;               /* process id */
+   int            pid;               /* process id */
    int            exitCode;
    int            priority;
    int (* start_func) (char *);   /* function where process begins -- launch */
@@ -34,6 +34,11 @@ struct proc_struct {
    int            kiddos;
    int            zapped;
    int            cpuTime;
+   proc_ptr       next_ready_ptr;    /* links on the ready queue */
+   proc_ptr       prev_ready_ptr;
+   proc_ptr       next_free_ptr;     /* link on the free or reap list */
+   int            slot;              /* index in the process table */
+   int            generation;        /* bumped each time the slot is reused */
 };
 
 struct psr_bits {
@@ -63,4 +68,27 @@ union psr_values {
 #define QUIT            3
 #define JOIN_BLOCKED    4
 #define ZAPPED          5
-#define RECORDED_QUIT   6
\ No newline at end of file
+#define RECORDED_QUIT   6
+
+// Ready processes: an intrusive queue per priority plus a bitmap of the
+// priorities that have anyone ready, so every operation is constant time.
+typedef struct
+{
+   proc_ptr pHead[SENTINELPRIORITY];
+   proc_ptr pTail[SENTINELPRIORITY];
+   unsigned int bitmap;   // Bit (priority - 1) set when that queue is not empty
+} ReadyQueue;
+
+// Pids carry their process table slot and the slot's generation (see
+// PID_GENERATIONS in phase1.h), so a pid left over from an earlier use of
+// the slot does not name the new process until the generation wraps.
+
+// Process table slots not in use, handed out in the order they were freed.
+typedef struct
+{
+   proc_ptr pFreeHead;        // Oldest free slot
+   proc_ptr pFreeTail;
+   proc_ptr pReapHead;        // RECORDED_QUIT entries waiting to be deleted
+   proc_ptr pReapTail;
+   int capacity;              // Slots in the chunks allocated so far
+} SlotTable;
@@ -2,9 +2,14 @@ void
 p1_fork(int pid)
 {}
 
+/* Context switches so far, for test37 */
+int p1_switches = 0;
+
 void
 p1_switch(int old, int new)
-{}
+{
+    p1_switches++;
+}
 
 void
 p1_quit(int pid)
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <strings.h>
 #include <phase1.h>
 #include "kernel.h"
 
@@ -21,6 +22,10 @@ int unblock_proc(int pid);
 int zap (int pid_to_zap);
 extern int start1 (char *);
 static int GetNextPid();
+static int GrowProcTable(void);
+static int SlotPid(int slot, int generation);
+static proc_ptr ProcEntry(int slot);
+static void FreeSlot(proc_ptr pProc);
 static void check_deadlock();
 static void enableInterrupts();
 void clock_handler(int dev, void *arg);
@@ -31,26 +36,33 @@ void launch();
 void ListAdd(ProcList *pList, struct proc_struct *pProc);
 void ListInit(ProcList *pList);
 void ListPrint(ProcList *pList);
+void ReadyAdd(proc_ptr pProc);
+void ReadyInit(ReadyQueue *pQueue);
+void ReadyRemove(proc_ptr pProc);
+void RecordQuit(proc_ptr pProc);
 void time_slice(void);
 struct proc_struct *ListPop(ProcList *pList);
 proc_ptr GetNextProcess();
+proc_ptr PidToProc(int pid);
+proc_ptr ReadyPop(void);
+int ReadyHighest(void);
 
 /* -------------------------- Globals ------------------------------------- */
 
 /* Debugging global variable... */
 int debugflag = 1;
 
-/* the process table */
-proc_struct ProcTable[MAXPROC];
+/* the process table, grown a chunk at a time */
+static proc_table ProcTable = { sizeof(proc_struct), NULL };
 
 /* Process lists  */
-ProcList ReadyList[6];
+ReadyQueue ReadyProcs;
 
 /* current process ID */
 proc_ptr Current;
 
-/* the next pid to be assigned */
-unsigned int next_pid = SENTINELPID;
+/* free process table slots and their generations */
+SlotTable Slots;
 numProc = 0;
 
 // Human readable format for process status.
@@ -68,7 +80,6 @@ static char *statusText[] = {"EMPTY", "READY", "RUNNING", "QUIT",
    ----------------------------------------------------------------------- */
 void startup()
 {
-   int i;      /* loop index */
    int result; /* value returned by call to fork1() */
 
    /* initialize the process table */
@@ -79,10 +90,7 @@ void startup()
       console("startup(): initializing the Ready & JOIN_BLOCKED lists\n");
    }
 
-   for (i = 0; i < HIGHEST_PRIORITY; i++)
-   {
-      ListInit(&ReadyList[i]);
-   }
+   ReadyInit(&ReadyProcs);
 
    /* Initialize the clock interrupt handler */
    int_vec[CLOCK_INT] = clock_handler;
@@ -170,18 +178,35 @@ int fork1(char *name, int (*f)(char *), char *arg, int stacksize, int priority)
       halt(1);
    }
 
+   // The ready queue only has room for valid priorities.
+   if ((priority < MAXPRIORITY || priority > MINPRIORITY) &&
+       (priority != SENTINELPRIORITY || f != sentinel))
+   {
+      return -1;
+   }
+
    disableInterrupts();
 
-   for (int i = 1; i <= MAXPROC; ++i)
+   // Delete the processes joined since the last fork, oldest first so their
+   // slots are reused in the order they were joined.
+   while (Slots.pReapHead != NULL)
    {
-      int procSlot = i%MAXPROC;
-      if (ProcTable[procSlot].status == RECORDED_QUIT)
-      {
-         deleteProcess(procSlot);
-      }
+      pEntry = Slots.pReapHead;
+      Slots.pReapHead = pEntry->next_free_ptr;
+      deleteProcess(pEntry->slot);
    }
+
+   Slots.pReapTail = NULL;
+
    newPid = GetNextPid();
-   pEntry = &ProcTable[newPid%MAXPROC];
+
+   if (newPid < 0)
+   {
+      enableInterrupts();
+      return -1;
+   }
+
+   pEntry = ProcEntry(proc_slot(newPid));
 
    pEntry->stack = malloc(stacksize);
    pEntry->stacksize = stacksize;
@@ -232,7 +257,7 @@ int fork1(char *name, int (*f)(char *), char *arg, int stacksize, int priority)
    context_init(&(pEntry->state), psr_get(),
                 pEntry->stack, pEntry->stacksize, launch);
    
-   ListAdd(&ReadyList[priority-1], pEntry);
+   ReadyAdd(pEntry);
 
    if (Current != NULL)
    {
@@ -246,20 +271,21 @@ int fork1(char *name, int (*f)(char *), char *arg, int stacksize, int priority)
             
          }
 
-         pEntry->next_sibling_ptr = &ProcTable[newPid%MAXPROC];
+         pEntry->next_sibling_ptr = ProcEntry(proc_slot(newPid));
+         pEntry->next_sibling_ptr->prev_sibling_ptr = pEntry;
          Current->kiddos++;
       }
 
       else
       {
-         Current->child_proc_ptr = &ProcTable[newPid%MAXPROC];
+         Current->child_proc_ptr = ProcEntry(proc_slot(newPid));
          Current->kiddos++;
       }
    }
 
    else
    {
-      ProcTable[newPid%MAXPROC].parent_proc_ptr = Current;
+      ProcEntry(proc_slot(newPid))->parent_proc_ptr = Current;
    }
 
    enableInterrupts();
@@ -324,7 +350,9 @@ int join(int *code)
    int pid = -2;
    disableInterrupts();
 
-   if (Current->child_proc_ptr != NULL)
+   // kiddos counts the children not yet joined; with none left the sibling
+   // walks below would run off the end of the list.
+   if (Current->child_proc_ptr != NULL && Current->kiddos > 0)
    {
       if (Current->child_proc_ptr->status == QUIT && 
             Current->child_proc_ptr->next_sibling_ptr == NULL)
@@ -340,7 +368,7 @@ int join(int *code)
       {
          if (Current->child_proc_ptr->status == QUIT)
          {
-            Current->child_proc_ptr->status = RECORDED_QUIT;
+            RecordQuit(Current->child_proc_ptr);
             pid = Current->child_proc_ptr->pid;
             *code = Current->child_proc_ptr->exitCode;
             Current->kiddos--;
@@ -348,7 +376,7 @@ int join(int *code)
 
          else if (Current->child_proc_ptr->next_sibling_ptr->status == QUIT)
          {
-            Current->child_proc_ptr->next_sibling_ptr->status = RECORDED_QUIT;
+            RecordQuit(Current->child_proc_ptr->next_sibling_ptr);
             pid = Current->child_proc_ptr->next_sibling_ptr->pid;
             *code = Current->child_proc_ptr->next_sibling_ptr->exitCode;
             Current->kiddos--;
@@ -366,7 +394,7 @@ int join(int *code)
 
             if (findQuitSib->status == QUIT)
             {
-               findQuitSib->status = RECORDED_QUIT;
+               RecordQuit(findQuitSib);
                pid = findQuitSib->pid;
                *code = findQuitSib->exitCode;
                Current->kiddos--;
@@ -376,7 +404,7 @@ int join(int *code)
             {
                Current->status = JOIN_BLOCKED;
                dispatcher();
-               findQuitSib->status = RECORDED_QUIT;
+               RecordQuit(findQuitSib);
                pid = findQuitSib->pid;
                *code = findQuitSib->exitCode;
                Current->kiddos--;
@@ -387,7 +415,7 @@ int join(int *code)
          {
          Current->status = JOIN_BLOCKED;
          dispatcher();
-         Current->child_proc_ptr->next_sibling_ptr->status = RECORDED_QUIT;
+         RecordQuit(Current->child_proc_ptr->next_sibling_ptr);
          pid = Current->child_proc_ptr->next_sibling_ptr->pid;
          *code = Current->child_proc_ptr->next_sibling_ptr->exitCode;
          Current->kiddos--;
@@ -398,7 +426,7 @@ int join(int *code)
       {
          Current->status = JOIN_BLOCKED;
          dispatcher();
-         Current->child_proc_ptr->status = RECORDED_QUIT;
+         RecordQuit(Current->child_proc_ptr);
          pid = Current->child_proc_ptr->pid;
          *code = Current->child_proc_ptr->exitCode;
          Current->kiddos--;
@@ -432,8 +460,7 @@ void quit(int code)
       if (parent->status == JOIN_BLOCKED)
       {
          parent->status = READY;
-         int priority = parent->priority;
-         ListAdd(&ReadyList[priority-1], parent);
+         ReadyAdd(parent);
       }
    }
 
@@ -453,29 +480,17 @@ void quit(int code)
 void dispatcher(void)
 {
    int switchProcesses = 0;
-   int i;
+   int highest;
    proc_ptr nextProcess = NULL;
 
    if (Current != NULL && Current->status == RUNNING)
    {
-      if (Current->priority > Current->child_proc_ptr->priority && 
-            Current->child_proc_ptr-> status != QUIT)
-         {
-            Current->status = READY;
-            ListAdd(&ReadyList[Current->priority -1], Current);
-            switchProcesses = 1;
-         }
+      // Preempt only for a process of higher priority.
+      highest = ReadyHighest();
 
-      else
+      if (highest != 0 && highest < Current->priority)
       {
-         for (i = 0; i < Current->priority - 1; ++i)
-         {
-            if (ReadyList[i].count > 0)
-            {
-               switchProcesses = 1;
-               break;
-            }
-         }
+         switchProcesses = 1;
       }
    }
 
@@ -527,11 +542,13 @@ static void check_deadlock()
 {
    int processes = 0;
 
-   for (int i = 0; i < MAXPROC; i++)
+   for (int i = 0; i < Slots.capacity; i++)
    {
-      if (ProcTable[i].status != EMPTY)
+      proc_ptr pProc = ProcEntry(i);
+
+      if (pProc->status != EMPTY)
       {
-         if (ProcTable[i].status != QUIT && ProcTable[i].status != RECORDED_QUIT)
+         if (pProc->status != QUIT && pProc->status != RECORDED_QUIT)
          {
             processes++;
          }
@@ -603,7 +620,7 @@ int block_me(int new_status)
    }
 
    Current->status = new_status;
-   ListPop(Current);
+   ReadyRemove(Current);
    dispatcher();
 
 }
@@ -612,9 +629,14 @@ int unblock_proc(int pid)
 {
    int retValue = 0;
    proc_ptr unblock_ptr;
-   unblock_ptr = &ProcTable[pid%MAXPROC];
+   unblock_ptr = PidToProc(pid);
 
-   if (unblock_ptr->status == ZAPPED)
+   if (unblock_ptr == NULL)
+   {
+      retValue = -2;
+   }
+
+   else if (unblock_ptr->status == ZAPPED)
    {
       retValue = -1;
    }
@@ -658,7 +680,7 @@ int zap (int pid_to_zap)
 {
    int result = 0;
    int zapperPid = Current->pid;
-   int procSlot = pid_to_zap%MAXPROC;
+   proc_ptr procToZap;
 
    // Halt if attempting to zap self
    if (pid_to_zap == zapperPid)
@@ -669,26 +691,17 @@ int zap (int pid_to_zap)
 
    disableInterrupts();
 
-   if (ProcTable[procSlot].status == EMPTY || ProcTable[procSlot].pid != pid_to_zap)
+   procToZap = PidToProc(pid_to_zap);
+
+   if (procToZap == NULL)
    {
       console("Zap: Attempting to zap a process that doesn't exist.\n");
       halt(1);
    }
 
-   if (ProcTable[procSlot].status != QUIT)
+   if (procToZap->status != QUIT)
    {
-      proc_ptr procToZap;
-
-      for (int i = 0; i < MAXPROC; ++i)
-      {
-         if (ProcTable[i].pid == pid_to_zap)
-         {
-            procToZap = &ProcTable[i];
-            break;
-         }
-      }
-
-      ListAdd(&ProcTable[pid_to_zap%MAXPROC].next_zapped_ptr, procToZap);
+      ListAdd(&procToZap->next_zapped_ptr, procToZap);
       procToZap->status = ZAPPED;
       Current->status = JOIN_BLOCKED;
 
@@ -719,25 +732,187 @@ int is_zapped(void)
    }
 }
 
+/* ------------------------------------------------------------------------
+   Name - GetNextPid
+   Purpose - Takes the oldest free slot off the free list, growing the
+             process table by a chunk if none is free, and makes a pid for
+             it from the slot's generation.
+   Parameters - none
+   Returns - the new pid, or -1 if the process table is full
+   Side Effects - the slot is no longer free
+   ----------------------------------------------------------------------- */
 static int GetNextPid()
 {
-   int newPid = -1;
-   int procSlot = next_pid % MAXPROC;
+   proc_ptr pProc;
+   int newPid;
 
-   if (numProc <= MAXPROC)
+   if (Slots.pFreeHead == NULL && GrowProcTable() < 0)
    {
-      while (numProc < MAXPROC && ProcTable[procSlot].status != EMPTY)
-      {
-         next_pid++;
-         procSlot = next_pid % MAXPROC;
-      }
+      return -1;
+   }
+
+   pProc = Slots.pFreeHead;
+   Slots.pFreeHead = pProc->next_free_ptr;
 
-      newPid = next_pid++;
+   if (Slots.pFreeHead == NULL)
+   {
+      Slots.pFreeTail = NULL;
+   }
+
+   pProc->next_free_ptr = NULL;
+   newPid = SlotPid(pProc->slot, pProc->generation);
+
+   // Skip the generation that would make pid 0 on the next reuse.
+   pProc->generation = (pProc->generation + 1) % PID_GENERATIONS;
+
+   if (SlotPid(pProc->slot, pProc->generation) == 0)
+   {
+      pProc->generation++;
    }
 
    return newPid;
 }
 
+/* ------------------------------------------------------------------------
+   Name - GrowProcTable
+   Purpose - Adds a chunk of MAXPROC slots to the process table and puts
+             them on the free list. The first chunk starts at SENTINELPID
+             so the first processes get pids 1, 2, 3, ...
+   Parameters - none
+   Returns - 0, or -1 if the table already has MAXCHUNKS chunks
+   Side Effects - allocates memory
+   ----------------------------------------------------------------------- */
+static int GrowProcTable(void)
+{
+   int first = Slots.capacity;
+   int slot;
+   proc_ptr pProc;
+
+   if (first >= MAXPROCS)
+   {
+      return -1;
+   }
+
+   Slots.capacity += MAXPROC;
+
+   for (int i = 0; i < MAXPROC; i++)
+   {
+      slot = first + (SENTINELPID + i) % MAXPROC;
+      pProc = ProcEntry(slot);
+      pProc->slot = slot;
+      pProc->generation = (slot == 0) ? 1 : 0;
+      FreeSlot(pProc);
+   }
+
+   return 0;
+}
+
+/* ------------------------------------------------------------------------
+   Name - FreeSlot
+   Purpose - Puts an empty process table entry at the tail of the free list.
+   Parameters - the entry
+   Returns - nothing
+   Side Effects - none
+   ----------------------------------------------------------------------- */
+static void FreeSlot(proc_ptr pProc)
+{
+   pProc->next_free_ptr = NULL;
+
+   if (Slots.pFreeTail == NULL)
+   {
+      Slots.pFreeHead = pProc;
+   }
+
+   else
+   {
+      Slots.pFreeTail->next_free_ptr = pProc;
+   }
+
+   Slots.pFreeTail = pProc;
+}
+
+/* ------------------------------------------------------------------------
+   Name - SlotPid
+   Purpose - Makes the pid for a slot and generation.
+   Parameters - the slot and its generation
+   Returns - the pid
+   Side Effects - none
+   ----------------------------------------------------------------------- */
+static int SlotPid(int slot, int generation)
+{
+   return slot % MAXPROC +
+          MAXPROC * (generation + PID_GENERATIONS * (slot / MAXPROC));
+}
+
+/* ------------------------------------------------------------------------
+   Name - ProcEntry
+   Purpose - Finds the process table entry for a slot.
+   Parameters - the slot
+   Returns - the entry
+   Side Effects - allocates the slot's chunk the first time it is used
+   ----------------------------------------------------------------------- */
+static proc_ptr ProcEntry(int slot)
+{
+   return (proc_ptr) proc_table_entry(&ProcTable, slot);
+}
+
+/* ------------------------------------------------------------------------
+   Name - PidToProc
+   Purpose - Finds the process table entry for a pid.
+   Parameters - the pid to look up
+   Returns - the entry, or NULL if no live process has that pid, e.g.
+             because its slot has since been reused
+   Side Effects - none
+   ----------------------------------------------------------------------- */
+proc_ptr PidToProc(int pid)
+{
+   proc_ptr pProc;
+   int slot = proc_slot(pid);
+
+   if (slot < 0 || slot >= Slots.capacity)
+   {
+      return NULL;
+   }
+
+   pProc = ProcEntry(slot);
+
+   if (pProc->status == EMPTY || pProc->pid != pid)
+   {
+      return NULL;
+   }
+
+   return pProc;
+}
+
+/* ------------------------------------------------------------------------
+   Name - RecordQuit
+   Purpose - Marks a quit child as joined and queues it to be deleted by
+             the next fork1.
+   Parameters - the child that was joined
+   Returns - nothing
+   Side Effects - none
+   ----------------------------------------------------------------------- */
+void RecordQuit(proc_ptr pProc)
+{
+   if (pProc->status != RECORDED_QUIT)
+   {
+      pProc->status = RECORDED_QUIT;
+      pProc->next_free_ptr = NULL;
+
+      if (Slots.pReapTail == NULL)
+      {
+         Slots.pReapHead = pProc;
+      }
+
+      else
+      {
+         Slots.pReapTail->next_free_ptr = pProc;
+      }
+
+      Slots.pReapTail = pProc;
+   }
+}
+
 int getpid(void)
 {
    return Current->pid;
@@ -747,16 +922,8 @@ proc_ptr GetNextProcess()
 {
    proc_ptr nextProcess = NULL;
    proc_ptr prevProcess = NULL;
-   int i;
 
-   for (i = 0; i <= SENTINELPRIORITY - 1; ++i)
-   {
-      if (ReadyList[i].count != 0)
-      {
-         nextProcess = ListPop(&ReadyList[i]);
-         break;
-      }
-   }
+   nextProcess = ReadyPop();
 
    prevProcess = Current;
    Current = nextProcess;
@@ -764,23 +931,24 @@ proc_ptr GetNextProcess()
    if (prevProcess != NULL && prevProcess->status == RUNNING)
    {
       prevProcess->status = READY;
-      ListAdd(&ReadyList[prevProcess->priority -1], prevProcess);
+      ReadyAdd(prevProcess);
    }
 
    nextProcess->status = RUNNING;
 
+   // Tell the later phases before the new process runs; a process that
+   // is just starting never comes back here.
    if (prevProcess == NULL)
    {
+      p1_switch(0, nextProcess->pid);
       context_switch(NULL, &nextProcess->state);
    }
    
    else
    {
+      p1_switch(prevProcess->pid, nextProcess->pid);
       context_switch(&prevProcess->state, &nextProcess->state);
    }
-   
-   // Pick the next process to run
-   p1_switch(Current->pid, nextProcess->pid);
 
    return nextProcess;
 }
@@ -822,6 +990,136 @@ struct proc_struct *ListPop(ProcList *pList)
    return popProcess;
 }
 
+/* ------------------------------------------------------------------------
+   ReadyInit
+
+   Purpose -      Empties the ready queue
+   Parameters -   pQueue - The queue to initialize
+   Returns -      None
+   Side Effects - 
+   ----------------------------------------------------------------------- */
+void ReadyInit(ReadyQueue *pQueue)
+{
+   for (int i = 0; i < SENTINELPRIORITY; i++)
+   {
+      pQueue->pHead[i] = pQueue->pTail[i] = NULL;
+   }
+
+   pQueue->bitmap = 0;
+}
+
+/* ------------------------------------------------------------------------
+   ReadyAdd
+
+   Purpose -      Adds a process to the tail of the queue for its priority
+   Parameters -   pProc - The process to add
+   Returns -      None
+   Side Effects - Sets the priority's bit in the bitmap
+   ----------------------------------------------------------------------- */
+void ReadyAdd(proc_ptr pProc)
+{
+   int i = pProc->priority - 1;
+
+   pProc->next_ready_ptr = NULL;
+   pProc->prev_ready_ptr = ReadyProcs.pTail[i];
+
+   if (ReadyProcs.pTail[i] == NULL)
+   {
+      ReadyProcs.pHead[i] = pProc;
+   }
+
+   else
+   {
+      ReadyProcs.pTail[i]->next_ready_ptr = pProc;
+   }
+
+   ReadyProcs.pTail[i] = pProc;
+   ReadyProcs.bitmap |= 1u << i;
+}
+
+/* ------------------------------------------------------------------------
+   ReadyRemove
+
+   Purpose -      Takes a process off the ready queue from wherever it is
+   Parameters -   pProc - The process to remove; nothing happens if it is
+                          not queued
+   Returns -      None
+   Side Effects - Clears the priority's bit when its queue empties
+   ----------------------------------------------------------------------- */
+void ReadyRemove(proc_ptr pProc)
+{
+   int i = pProc->priority - 1;
+
+   if (pProc->prev_ready_ptr == NULL && ReadyProcs.pHead[i] != pProc)
+   {
+      return;
+   }
+
+   if (pProc->prev_ready_ptr == NULL)
+   {
+      ReadyProcs.pHead[i] = pProc->next_ready_ptr;
+   }
+
+   else
+   {
+      pProc->prev_ready_ptr->next_ready_ptr = pProc->next_ready_ptr;
+   }
+
+   if (pProc->next_ready_ptr == NULL)
+   {
+      ReadyProcs.pTail[i] = pProc->prev_ready_ptr;
+   }
+
+   else
+   {
+      pProc->next_ready_ptr->prev_ready_ptr = pProc->prev_ready_ptr;
+   }
+
+   pProc->next_ready_ptr = pProc->prev_ready_ptr = NULL;
+
+   if (ReadyProcs.pHead[i] == NULL)
+   {
+      ReadyProcs.bitmap &= ~(1u << i);
+   }
+}
+
+/* ------------------------------------------------------------------------
+   ReadyHighest
+
+   Purpose -      Finds the best priority that has a ready process
+   Parameters -   None
+   Returns -      The priority, or 0 if nothing is ready
+   Side Effects - 
+   ----------------------------------------------------------------------- */
+int ReadyHighest(void)
+{
+   // Priority 1 is the highest, so the lowest set bit wins.
+   return ffs(ReadyProcs.bitmap);
+}
+
+/* ------------------------------------------------------------------------
+   ReadyPop
+
+   Purpose -      Takes the first process of the best priority off the
+                  ready queue
+   Parameters -   None
+   Returns -      The process, or NULL if nothing is ready
+   Side Effects - 
+   ----------------------------------------------------------------------- */
+proc_ptr ReadyPop(void)
+{
+   proc_ptr pProc = NULL;
+   int priority = ReadyHighest();
+
+   if (priority != 0)
+   {
+      pProc = ReadyProcs.pHead[priority - 1];
+      ReadyRemove(pProc);
+   }
+
+   return pProc;
+}
+
 /* ------------------------------------------------------------------------
    ListInit
 
@@ -914,8 +1212,45 @@ void ListPrint(ProcList *pList)
 
 void deleteProcess(int pid)
 {
-   memset(&ProcTable[pid], 0, sizeof(ProcTable[pid]));
+   proc_ptr pProc = ProcEntry(pid);
+   proc_ptr parent = pProc->parent_proc_ptr;
+   proc_ptr child;
+   int generation;
+
+   // Unlink the entry from its family so nothing reaches the slot through a
+   // stale pointer once it holds a new process.
+   if (parent != NULL)
+   {
+      if (parent->child_proc_ptr == pProc)
+      {
+         parent->child_proc_ptr = pProc->next_sibling_ptr;
+      }
+
+      else if (pProc->prev_sibling_ptr != NULL)
+      {
+         pProc->prev_sibling_ptr->next_sibling_ptr = pProc->next_sibling_ptr;
+      }
+
+      if (pProc->next_sibling_ptr != NULL)
+      {
+         pProc->next_sibling_ptr->prev_sibling_ptr = pProc->prev_sibling_ptr;
+      }
+   }
+
+   for (child = pProc->child_proc_ptr; child != NULL;
+        child = child->next_sibling_ptr)
+   {
+      child->parent_proc_ptr = NULL;
+   }
+
+   // The slot keeps its number and generation for its next process.
+   generation = pProc->generation;
+   memset(pProc, 0, sizeof(*pProc));
+   pProc->slot = pid;
+   pProc->generation = generation;
    numProc--;
+
+   FreeSlot(pProc);
 }
 
 void dump_processes(void)
@@ -925,30 +1260,32 @@ void dump_processes(void)
    console("%-7s %-8s %-9s %-13s %-8s %-8s %-8s\n",
             "PID", "Parent", "Priority", "Status", "# Kids", "CPUtime", "Name");
 
-   for (int i = 0; i < MAXPROC; i++)
+   for (int i = 0; i < Slots.capacity; i++)
    {
-      if (ProcTable[i].status == 0)
+      proc_ptr pProc = ProcEntry(i);
+
+      if (pProc->status == 0)
       {
-         ProcTable[i].pid = -1;
-         ProcTable[i].priority = -1;
-         ProcTable[i].pid = -1;
-         ProcTable[i].cpuTime = -1;
-         ProcTable[i].kiddos = 0;
+         pProc->pid = -1;
+         pProc->priority = -1;
+         pProc->pid = -1;
+         pProc->cpuTime = -1;
+         pProc->kiddos = 0;
       }
 
-      if (ProcTable[i].parent_proc_ptr == NULL)
+      if (pProc->parent_proc_ptr == NULL)
       {
          parentPid = -1;
       }
 
       else
       {
-         parentPid = ProcTable[i].parent_proc_ptr->pid;
+         parentPid = pProc->parent_proc_ptr->pid;
       }
 
       console("%-7d %-8d %-9d %-13s %-8d %-8d %-8s\n",
-            ProcTable[i].pid, parentPid, ProcTable[i].priority, 
-            statusText[ProcTable[i].status], ProcTable[i].kiddos, 
-            ProcTable[i].cpuTime, ProcTable[i].name);          
+            pProc->pid, parentPid, pProc->priority, 
+            statusText[pProc->status], pProc->kiddos, 
+            pProc->cpuTime, pProc->name);          
    }
 }
\ No newline at end of file
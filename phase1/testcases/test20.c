@@ -14,14 +14,14 @@ int start1(char *arg)
 {
   int i, pid1;
 
-  console("TEST:");console("start %d processes\n",MAXPROC);
-  for (i=0;i<MAXPROC+2;i++) {
+  console("TEST:");console("start %d processes\n",MAXPROCS);
+  for (i=0;i<MAXPROCS+2;i++) {
 	  pid1 = fork1("XXp1", XXp1,"XXp1",USLOSS_MIN_STACK,2);
 	  if (pid1== -1) {
 		 console("TEST:");console("pid is -1.\n");
 	  }
   }
-  for (i=0;i<MAXPROC+2;i++) {
+  for (i=0;i<MAXPROCS+2;i++) {
 	  join(&pid1);
   }  
   quit(-1);
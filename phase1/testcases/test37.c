@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <time.h>
+#include <usloss.h>
+#include <phase1.h>
+
+/* The purpose of this test is to measure the cost of a context switch
+ * through the dispatcher. start1 forks a batch of lower priority
+ * children and then joins with each of them; every join blocks start1
+ * (one switch to a child) and the child's quit readies start1 again
+ * (one switch back). The switches are counted by p1_switch and the
+ * joins are timed on the host's monotonic clock. Timings depend on the
+ * host, so only the switch count is checked.
+ *
+ * Expected output:
+ * start1(): started
+ * start1(): 80 switches
+ * start1(): <N> usec per switch
+ * All processes complete.
+ */
+
+#define KIDS 40
+
+extern int p1_switches;
+
+int XXp1(char *);
+
+int start1(char *arg)
+{
+  int status, kid, switches;
+  struct timespec start, end;
+  double elapsed;
+
+  printf("start1(): started\n");
+  for (kid = 0; kid < KIDS; kid++) {
+    if (fork1("XXp1", XXp1, "XXp1", USLOSS_MIN_STACK, 3) < 0) {
+      printf("start1(): fork1 failed for child %d\n", kid);
+      return 1;
+    }
+  }
+  switches = p1_switches;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (kid = 0; kid < KIDS; kid++) {
+    if (join(&status) < 0) {
+      printf("start1(): join failed for child %d\n", kid);
+      return 1;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  switches = p1_switches - switches;
+  elapsed = (end.tv_sec - start.tv_sec) * 1e6 +
+            (end.tv_nsec - start.tv_nsec) / 1e3;
+  printf("start1(): %d switches\n", switches);
+  printf("start1(): %.2f usec per switch\n", elapsed / switches);
+  return 0;
+} /* start1 */
+
+int XXp1(char *arg)
+{
+  quit(-3);
+  return 0;
+} /* XXp1 */
@@ -47,7 +47,7 @@ int debugflag2 = 0;
 // The tables for our mailbox, mailslot, and process structures.
 mail_box MailBoxTable[MAXMBOX];
 mail_slot MailSlotTable[MAXSLOTS];
-mbox_proc ProcTable[MAXPROC];
+proc_table ProcTable = { sizeof(mbox_proc), NULL }; // Grows with phase 1's table.
 
 // Set numMboxes to zero for tracking how many mailboxes we have.
 int numMboxes = 0;
@@ -199,7 +199,7 @@ int MboxSend(int mbox_id, void *msg_ptr, int msg_size)
     int retValue = 0;
     int pid;
     int slotIndex;
-    int procIndex;
+    mbox_proc_ptr pProc;
     mbox_ptr pMailbox = NULL;
     slot_ptr pSlot = NULL;
     slot_ptr pop_slot = NULL;
@@ -232,12 +232,12 @@ int MboxSend(int mbox_id, void *msg_ptr, int msg_size)
     }
 
     pid = getpid();                              // Get a process ID.
-    procIndex = pid%MAXPROC;                     // Start the ProcTable at 1.
-    ProcTable[procIndex].pid = pid;              // Assign the proc ID.
-    ProcTable[procIndex].mbox_id = mbox_id;      // Assign the mailbox ID.
-    ProcTable[procIndex].status = READY;         // Set status to READY.
-    ProcTable[procIndex].pMessage = msg_ptr;     // Point to the message.
-    ProcTable[procIndex].messageSize = msg_size; // Set the message size. 
+    pProc = proc_entry(&ProcTable, pid);         // Our entry in the ProcTable.
+    pProc->pid = pid;                            // Assign the proc ID.
+    pProc->mbox_id = mbox_id;                    // Assign the mailbox ID.
+    pProc->status = READY;                       // Set status to READY.
+    pProc->pMessage = msg_ptr;                   // Point to the message.
+    pProc->messageSize = msg_size;               // Set the message size. 
 
     pSlot = &MailSlotTable[slotIndex];      // Point to the MailSlotTable.
     pSlot->mbox_id = mbox_id;               // Assign the mailbox ID.
@@ -371,7 +371,7 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size)
     slot_ptr pop_ptr = NULL;
     int retValue = 0;
     int pid;
-    int procIndex;
+    mbox_proc_ptr pProc;
 
     // Check if we're in kernel mode.
     check_kernel_mode("MboxReceive");
@@ -393,12 +393,12 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size)
     }
 
     pid = getpid();                              // Get a process ID.
-    procIndex = pid%MAXPROC;                     // Start the ProcTable at 1 instead of 0.
-    ProcTable[procIndex].pid = pid;              // Assign the proc ID.
-    ProcTable[procIndex].mbox_id = mbox_id;      // Assign the mailbox ID.
-    ProcTable[procIndex].status = READY;         // Set status to READY.
-    ProcTable[procIndex].pMessage = msg_ptr;     // Point to the message.
-    ProcTable[procIndex].messageSize = msg_size; // Set the message size.
+    pProc = proc_entry(&ProcTable, pid);         // Our entry in the ProcTable.
+    pProc->pid = pid;                            // Assign the proc ID.
+    pProc->mbox_id = mbox_id;                    // Assign the mailbox ID.
+    pProc->status = READY;                       // Set status to READY.
+    pProc->pMessage = msg_ptr;                   // Point to the message.
+    pProc->messageSize = msg_size;               // Set the message size.
 
     pMailbox = &MailBoxTable[mbox_id];           // Point to the MailBoxTable.
 
@@ -476,7 +476,7 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size)
     else if (pMailbox->nextMboxList.count == 0 || pMailbox->mailSlot == NULL)
     {
         // Add the process to the receive block list and block the process.
-        ListAdd(&pMailbox->recvBlockList, &ProcTable[procIndex]);
+        ListAdd(&pMailbox->recvBlockList, pProc);
         block_me(NO_MAIL);
 
         // Check if the message size from the mailslot is greater than
@@ -660,7 +660,7 @@ int MboxReceive(int mbox_id, void *msg_ptr, int msg_size)
 int MboxCondReceive(int mbox_id, void *msg_ptr, int msg_size)
 {
     int pid;
-    int procIndex;
+    mbox_proc_ptr pProc;
     int retValue;
     slot_ptr pop_ptr;
     mbox_ptr pMailbox;
@@ -669,12 +669,12 @@ int MboxCondReceive(int mbox_id, void *msg_ptr, int msg_size)
     check_kernel_mode("MboxCondReceive");
 
     pid = getpid();                              // Get a process ID.
-    procIndex = pid%MAXPROC;                     // Start the ProcTable at 1 instead of 0.
-    ProcTable[procIndex].pid = pid;              // Assign the proc ID.
-    ProcTable[procIndex].mbox_id = mbox_id;      // Assign the mailbox ID.
-    ProcTable[procIndex].status = READY;         // Set status to READY.
-    ProcTable[procIndex].pMessage = msg_ptr;     // Point to the message.
-    ProcTable[procIndex].messageSize = msg_size; // Set the message size.
+    pProc = proc_entry(&ProcTable, pid);         // Our entry in the ProcTable.
+    pProc->pid = pid;                            // Assign the proc ID.
+    pProc->mbox_id = mbox_id;                    // Assign the mailbox ID.
+    pProc->status = READY;                       // Set status to READY.
+    pProc->pMessage = msg_ptr;                   // Point to the message.
+    pProc->messageSize = msg_size;               // Set the message size.
     
     pMailbox = &MailBoxTable[mbox_id];           // Point to the MailBoxTable.
 
@@ -738,7 +738,7 @@ int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size)
 {
     int slotIndex;
     int pid;
-    int procIndex;
+    mbox_proc_ptr pProc;
     slot_ptr pSlot;
     slot_ptr pop_slot;
     mbox_ptr pMailbox;
@@ -756,12 +756,12 @@ int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size)
     }
 
     pid = getpid();                              // Get a process ID.
-    procIndex = pid%MAXPROC;                     // Start the ProcTable at 1 instead of 0.
-    ProcTable[procIndex].pid = pid;              // Assign the proc ID.
-    ProcTable[procIndex].mbox_id = mbox_id;      // Assign the mailbox ID.
-    ProcTable[procIndex].status = READY;         // Set status to READY.
-    ProcTable[procIndex].pMessage = msg_ptr;     // Point to the message.
-    ProcTable[procIndex].messageSize = msg_size; // Set the message size.
+    pProc = proc_entry(&ProcTable, pid);         // Our entry in the ProcTable.
+    pProc->pid = pid;                            // Assign the proc ID.
+    pProc->mbox_id = mbox_id;                    // Assign the mailbox ID.
+    pProc->status = READY;                       // Set status to READY.
+    pProc->pMessage = msg_ptr;                   // Point to the message.
+    pProc->messageSize = msg_size;               // Set the message size.
 
     pSlot = &MailSlotTable[slotIndex];      // Point to the MailSlotTable.
     pSlot->mbox_id = mbox_id;               // Assign the mailbox ID.
@@ -825,6 +825,7 @@ int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size)
 int MboxRelease(int mbox_id)
 {
     int pid;
+    mbox_proc_ptr pProc;
     mbox_ptr pDeleteMbox = NULL;
     slot_ptr pop_ptr = NULL;
     slot_ptr pop_slot = NULL;
@@ -837,8 +838,9 @@ int MboxRelease(int mbox_id)
 
     pDeleteMbox = &MailBoxTable[mbox_id];   // Point to the mailbox we're going to delete.
     pid = getpid();                         // Get a process ID.
-    ProcTable[pid%MAXPROC].pid = pid;       // Assign the process ID.
-    ProcTable[pid%MAXPROC].status = READY;  // Set the process to READY.
+    pProc = proc_entry(&ProcTable, pid);    // Our entry in the ProcTable.
+    pProc->pid = pid;                       // Assign the process ID.
+    pProc->status = READY;                  // Set the process to READY.
 
     // Check for a valid mailbox.
     if (pDeleteMbox == NULL || pDeleteMbox->status == EMPTY)
@@ -1064,11 +1066,7 @@ void InitTables()
         memset(&MailSlotTable[j].message, 0, sizeof(MAX_MESSAGE));
     }
 
-    // Clear junk values from the ProcTable at index k.
-    for (int k = 0; k < MAXPROC; k++)
-    {
-        memset(&ProcTable[k], 0, sizeof(ProcTable[k]));
-    }
+    // The ProcTable needs no clearing; proc_entry() hands out zeroed chunks.
 
 } /* InitTables */
 
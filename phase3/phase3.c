@@ -17,6 +17,7 @@ int semv_real(int semaphore);
 int spawn_real(char *name, int (*func)(char *), char *arg, int stack_size, int priority);
 int start2(char *); 
 int wait_real(int *status);
+static user_ptr GetUserProc(int pid);
 void check_kernel_mode (char *procName);
 void InitTables();
 void ListAdd(List *pList, void* pNode);
@@ -27,7 +28,8 @@ static void sysCall(sysargs *pSysarg);
 struct UserProcess *ListPop(List *pList);
 
 /* -------------------------- Globals ------------------------------------- */
-UserProcess UserProcTable[MAXPROC]; // UserProcessTable
+proc_table UserProcTable = { sizeof(UserProcess), NULL }; // UserProcessTable
+UserProcess NoUserProc;             // Stands in for pids never handed out.
 Semaphore SemTable[MAXSEMS];        // SemTable
 int semID = 0;                      // Assigning unique semaphore IDs.
 
@@ -237,7 +239,7 @@ int spawn_real(char *name, int (*func)(char *), char *arg, int stack_size, int p
     }
 
     // Create a pointer to the slot in the UserProcTable for the child.
-    child_ptr = &UserProcTable[kidpid%MAXPROC];
+    child_ptr = GetUserProc(kidpid);
 
     // If the child's status is empty.
     if (child_ptr->status == EMPTY)
@@ -253,7 +255,7 @@ int spawn_real(char *name, int (*func)(char *), char *arg, int stack_size, int p
     child_ptr->priority = priority;     // Set the priority for the process.
 
     // Create a pointer to the slot in Table for the parent of the process.
-    parent_ptr = &UserProcTable[getpid()%MAXPROC];
+    parent_ptr = GetUserProc(getpid());
 
     // If name isn't NULL, copy name to the child process.
     if (name != NULL)
@@ -292,14 +294,11 @@ int spawn_real(char *name, int (*func)(char *), char *arg, int stack_size, int p
    ----------------------------------------------------------------------- */
 static int spawn_launch(char *arg)
 {
-    int index;
     int result;
     user_ptr proc_ptr;
 
-    // Get the pid of the process.
-    index = getpid() % MAXPROC;
     // Set a pointer to the slot in the UserProcTable.
-    proc_ptr = &UserProcTable[index];
+    proc_ptr = GetUserProc(getpid());
 
     // If the child has a higher priority, it will need to populate it's
     // structure instead of it's parent doing it.
@@ -318,7 +317,7 @@ static int spawn_launch(char *arg)
         // Then set up user mode, call the function, and terminate the process
         // after it has finished running. 
         psr_set(psr_get() & ~PSR_CURRENT_MODE);
-        result = UserProcTable[index].startFunc(UserProcTable[index].arg);
+        result = proc_ptr->startFunc(proc_ptr->arg);
         Terminate(result);
     }
 
@@ -357,13 +356,13 @@ int wait_real(int *status)
     }
 
     // Get the parent pid for the user process if one exists.
-    parent_pid = UserProcTable[pid%MAXPROC].ppid;
+    parent_pid = GetUserProc(pid)->ppid;
 
     // If the child is on the parent process' children list.
-    if (UserProcTable[parent_pid%MAXPROC].children.count != 0)
+    if (GetUserProc(parent_pid)->children.count != 0)
     {
         // Pop the process off the parent's list and get the child's pid.
-        pop_ptr = ListPop(&UserProcTable[parent_pid%MAXPROC].children);
+        pop_ptr = ListPop(&GetUserProc(parent_pid)->children);
         pid = pop_ptr->pid;
     }
 
@@ -480,12 +479,12 @@ int semp_real(int semaphore)
     else
     {
         // Get the parent pid and check if it has any children.
-        ppid = UserProcTable[getpid()%MAXPROC].ppid;
-        if (&UserProcTable[ppid%MAXPROC].children != 0)
+        ppid = GetUserProc(getpid())->ppid;
+        if (&GetUserProc(ppid)->children != 0)
         {
             // Pop a process off the list, add the process to the waitingproc list
             // and perform an mboxreceive for the semaphore and for the process.
-            block_ptr = ListPop(&UserProcTable[ppid%MAXPROC].children);
+            block_ptr = ListPop(&GetUserProc(ppid)->children);
             ListAdd(&SemTable[semaphore].waitingProcs, block_ptr);
             MboxReceive(SemTable[semaphore].semMbox, NULL, 0);
             MboxReceive(block_ptr->mboxStartup, NULL, 0);
@@ -495,7 +494,7 @@ int semp_real(int semaphore)
         {
             // If the process isn't on the children list we add it to the waitingprocs,
             // list and perform an mboxreceive for the semaphore and for the process.
-            block_ptr = &UserProcTable[getpid()%MAXPROC];
+            block_ptr = GetUserProc(getpid());
             ListAdd(&SemTable[semaphore].waitingProcs, block_ptr);
             MboxReceive(SemTable[semaphore].semMbox, NULL, 0);
             MboxReceive(block_ptr->mboxStartup, NULL, 0);
@@ -568,7 +567,7 @@ void terminate_real(int exit_code)
     user_ptr pop_ptr;
 
     // Pointer to the slot in the UserProcTable.
-    proc_ptr = &UserProcTable[getpid()%MAXPROC];
+    proc_ptr = GetUserProc(getpid());
 
     // If there are children on the list.
     if (proc_ptr->children.count != 0)
@@ -582,10 +581,10 @@ void terminate_real(int exit_code)
         }
 
         // If the terminating process is on a parent's children list.
-        if (UserProcTable[proc_ptr->ppid%MAXPROC].children.count != 0)
+        if (GetUserProc(proc_ptr->ppid)->children.count != 0)
         {
             // Pop the process of the list, set the status to EMPTY and call quit.
-            pop_ptr = ListPop(&UserProcTable[proc_ptr->ppid%MAXPROC].children);
+            pop_ptr = ListPop(&GetUserProc(proc_ptr->ppid)->children);
             pop_ptr->status = EMPTY;
             quit(exit_code);
         }
@@ -633,13 +632,32 @@ void InitTables()
     {
         memset(&SemTable[i], 0, sizeof(SemTable[i]));
     }
-    
-    // Clear junk values from the UserProcTable at index j.
-    for (int j = 0; j < MAXPROC; j++)
+
+    // The UserProcTable needs no clearing; proc_entry() hands out zeroed
+    // chunks.
+} /* InitTables */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   GetUserProc
+   Purpose      -   Finds the UserProcTable entry for a process.
+   Parameters   -   pid - The process ID.
+   Returns      -   Pointer to the entry. Pids that were never handed out,
+                    such as the ppid of a process with no parent, share the
+                    empty NoUserProc entry.
+   Side Effects -   Grows the UserProcTable the first time a chunk is used.
+   ----------------------------------------------------------------------- */
+static user_ptr GetUserProc(int pid)
+{
+    user_ptr proc_ptr = proc_entry(&UserProcTable, pid);
+
+    if (proc_ptr == NULL)
     {
-        memset(&UserProcTable[j], 0, sizeof(UserProcTable[j]));
+        return &NoUserProc;
     }
-} /* InitTables */
+
+    return proc_ptr;
+} /* GetUserProc */
 
 
 /* ------------------------------------------------------------------------
@@ -5,6 +5,7 @@
 #ifndef _PHASE1_H
 #define _PHASE1_H
 
+#include <stdlib.h>
 #include <usloss.h>
 
 /*
@@ -13,6 +14,26 @@
 
 #define MAXPROC		50
 
+/*
+ * The process table grows MAXPROC entries (one chunk) at a time, up to
+ * MAXCHUNKS chunks, as more processes are alive at once. Chunks are never
+ * freed, so the table stays at the most processes that were ever alive
+ * at once.
+ */
+
+#define MAXCHUNKS	64
+#define MAXPROCS	(MAXPROC * MAXCHUNKS)
+
+/*
+ * A pid names its slot in the process table and the slot's generation:
+ *	pid = slot % MAXPROC + MAXPROC * (generation + PID_GENERATIONS * chunk)
+ * A kernel that never grows past one chunk can hand out any pids that are
+ * distinct mod MAXPROC among the live processes. Pids run into the
+ * millions (MAXPROCS * PID_GENERATIONS), so keep them in ints.
+ */
+
+#define PID_GENERATIONS	1000
+
 /*
  * Maximum length of a process name
  */
@@ -36,6 +57,58 @@
 /* the lowest priority a process can have */
 #define LOWEST_PRIORITY 6
 
+/*
+ * A per-process table that grows the same way, for state that later phases
+ * keep about each process. Entries never move once they exist. Chunks are
+ * zero-filled, then init (if not NULL) is called on each entry of a new chunk.
+ * The lookups only use the pid, so they work with any phase1 library.
+ */
+
+typedef struct proc_table {
+	int	entry_size;
+	void	(*init)(void *entry);
+	char	*chunks[MAXCHUNKS];
+} proc_table;
+
+/* Slot of a pid, or -1 if no phase1 could have handed the pid out */
+static inline int
+proc_slot(int pid)
+{
+	if (pid <= 0 || pid / (MAXPROC * PID_GENERATIONS) >= MAXCHUNKS)
+		return -1;
+	return pid / (MAXPROC * PID_GENERATIONS) * MAXPROC + pid % MAXPROC;
+}
+
+/* Entry of a slot, allocating its chunk the first time it is used */
+static inline void *
+proc_table_entry(proc_table *table, int slot)
+{
+	char	*chunk = table->chunks[slot / MAXPROC];
+	int	i;
+
+	if (chunk == NULL) {
+		chunk = calloc(MAXPROC, table->entry_size);
+		if (chunk == NULL) {
+			console("proc_table_entry(): out of memory\n");
+			halt(1);
+		}
+		if (table->init != NULL)
+			for (i = 0; i < MAXPROC; i++)
+				table->init(chunk + i * table->entry_size);
+		table->chunks[slot / MAXPROC] = chunk;
+	}
+	return chunk + (slot % MAXPROC) * table->entry_size;
+}
+
+/* Entry of a pid, or NULL if proc_slot rejects the pid */
+static inline void *
+proc_entry(proc_table *table, int pid)
+{
+	int	slot = proc_slot(pid);
+
+	return (slot < 0) ? NULL : proc_table_entry(table, slot);
+}
+
 /* 
  * Function prototypes for this phase.
  */
@@ -55,6 +128,7 @@ extern  void	time_slice(void);
 extern  void	dispatcher(void);
 extern	int		readtime(void);
 
+
 extern	void		p1_fork(int pid);
 extern	void		p1_quit(int pid);
 extern	void		p1_switch(int old, int new);
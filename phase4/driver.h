@@ -11,6 +11,7 @@ struct driver_proc {
     int         track_start;    // Track starting location.
     int         track_curr;     // Track current location.
     int         sector_start;   // Sector starting location.
+    int         sector_curr;    // Sector current location.
     int         sector_count;   // Sector count.
     int         num_sectors;    // Total sectors.
     void        *disk_buf;      // Buffer location.
@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -12,14 +13,14 @@
 
 /* ------------------------- Prototypes ----------------------------------- */
 int diskReadWrite(int io, int unit, int track, int first, int sectors, void *buffer);
-int diskRead_real(int unit, int track, int first, int sectors, void *buffer);
 int diskSize_real(int unit, int *sector, int *track, int *disk);
-int diskWrite_real(int unit, int track, int first, int sectors, void *buffer);
 int orderByTrack(void *pStruct1, void *pStruct2);
 int orderByWake(void *pStruct1, void *pStruct2);
 int sleep_real(int seconds);
 static int ClockDriver(char *);
 static int DiskDriver(char *);
+static void InitDriverProc(void *pEntry);
+static void RequestSemaphore(proc_ptr driver_ptr, char *procName);
 static void *ListGetNextNode(List *pList,  void *pCurrentStucture);
 static void *ListPopNode(List *pList);
 static void ListAddNode(List *pList, void *pStructToAdd);
@@ -28,7 +29,6 @@ static void ListInitialize(List *pList, int nextPrevOffset, int (*orderFunction)
 static void ListRemoveNode(List *pList, void *pStructToRemove);
 static void sysCall4(sysargs *pSysarg);
 void check_kernel_mode (char *procName);
-void InitDriverTable();
 
 /* -------------------------- Globals ------------------------------------- */
 int upElevator = 1;                                 // Flag for traveling up or down a list.
@@ -36,7 +36,8 @@ static int diskpids[DISK_UNITS];                    // Disks to be zapped.
 static int diskSemaphore[DISK_UNITS];               // Disk semaphores.
 static int diskTracks[DISK_UNITS];                  // Total tracks per disk.
 static int running;                                 // Semaphore for blocking.
-static struct driver_proc Driver_Table[MAXPROC];    // Driver_table for processes.
+static proc_table Driver_Table =                    // Driver_table for processes.
+    { sizeof(struct driver_proc), InitDriverProc };
 List diskQueues[DISK_UNITS];                        // List of processes waiting to READ/WRITE.
 List sleepingList;                                  // List of sleeping processes.
 
@@ -67,10 +68,10 @@ int start3(char *arg)
     sys_vec[SYS_DISKSIZE] = sysCall4;
     sys_vec[SYS_DISKWRITE] = sysCall4;
 
-    // Initialize Driver_Table and both lists.
-    InitDriverTable();
+    // Initialize both lists. Driver_Table entries are initialized by
+    // InitDriverProc as the table grows.
     ListInitialize(&sleepingList, 0, orderByWake);
-    offset = (void *) &Driver_Table[0].next_ptr - (void *) &Driver_Table[0];
+    offset = offsetof(struct driver_proc, next_ptr);
     
     for (int i = 0; i < DISK_UNITS; i++)
     {
@@ -195,6 +196,7 @@ static int DiskDriver(char *arg)
     int unit = atoi(arg);
     device_request my_request;
     proc_ptr current_req = NULL;
+    struct driver_proc marker;
 
     // Get the number of tracks for this disk.
     my_request.opr = DISK_TRACKS;
@@ -211,6 +213,10 @@ static int DiskDriver(char *arg)
     waitdevice(DISK_DEV, unit, &status);
     semv_real(running);
 
+    // The disk arm starts out at track 0.
+    marker.pid = -1;
+    marker.track_start = 0;
+
     // While we're not zapped.
     while (! is_zapped())
     {
@@ -223,19 +229,15 @@ static int DiskDriver(char *arg)
         	return retValue;
         }
         
-        // Add the first request back to the list and then remove it so
+        // Put a marker on the list where the last request was so
         // ListGetNextNode knows the next process to get from the list.
-        if (current_req != NULL)
-        {
-            if (current_req->next_ptr == NULL && current_req->prev_ptr == NULL)
-            {
-                ListAddNodeInOrder(&diskQueues[unit], current_req);
-                ListRemoveNode(&diskQueues[unit], current_req);
-            }
-        }
+        // The last request itself can't mark the spot: its process may
+        // already have queued its next request in the same entry.
+        ListAddNodeInOrder(&diskQueues[unit], &marker);
 
-        // Get a request from the list and then remove it.
-        current_req = ListGetNextNode(&diskQueues[unit], current_req);
+        // Get a request from the list and then remove it and the marker.
+        current_req = ListGetNextNode(&diskQueues[unit], &marker);
+        ListRemoveNode(&diskQueues[unit], &marker);
         ListRemoveNode(&diskQueues[unit], current_req);
 
         // Move the track to the beginning.
@@ -304,6 +306,7 @@ static int DiskDriver(char *arg)
         }
 
         // Unblock.
+        marker.track_start = current_req->track_curr;
         semv_real(current_req->sem_id);
     }
 
@@ -325,13 +328,14 @@ int sleep_real(int seconds)
     proc_ptr sleep_ptr;
 
     // Pointer to the process on the Driver_Table
-    sleep_ptr = &Driver_Table[pid%MAXPROC];
+    sleep_ptr = proc_entry(&Driver_Table, pid);
 
     // Set the time the process will wake up in milliseconds and assign the pid.
     sleep_ptr->wake_time = sys_clock() + (seconds * 1000000);
     sleep_ptr->pid = pid;
 
     // Add the process to the sleeping list and block.
+    RequestSemaphore(sleep_ptr, "sleep_real");
     ListAddNodeInOrder(&sleepingList, sleep_ptr);
     semp_real(sleep_ptr->sem_id);
 
@@ -409,7 +413,7 @@ int diskReadWrite(int io, int unit, int track, int first, int sectors, void *buf
     }
 
     // Populate the disk driver process.
-    disk_proc_ptr = &Driver_Table[getpid()%MAXPROC];
+    disk_proc_ptr = proc_entry(&Driver_Table, getpid());
     disk_proc_ptr->pid = getpid();
     disk_proc_ptr->operation = io;
     disk_proc_ptr->track_start = track;
@@ -419,6 +423,7 @@ int diskReadWrite(int io, int unit, int track, int first, int sectors, void *buf
 
     // Add the process to the list, unblock the diskdriver, and
     // block the process.
+    RequestSemaphore(disk_proc_ptr, "diskReadWrite");
     ListAddNodeInOrder(&diskQueues[unit], disk_proc_ptr);
     semv_real(diskSemaphore[unit]);
     semp_real(disk_proc_ptr->sem_id);
@@ -427,6 +432,56 @@ int diskReadWrite(int io, int unit, int track, int first, int sectors, void *buf
 } /* diskReadWrite */
 
 
+/* ------------------------------------------------------------------------
+   Name         -   disk_read_real
+   Purpose      -   Kernel-mode disk read for later phases.
+   Parameters   -   unit - Disk unit.
+                    track - Starting track.
+                    first - Starting sector.
+                    sectors - Total sectors.
+                    buffer - Memory address to read into.
+   Returns      -   See diskReadWrite.
+   Side Effects -   Blocks until the disk driver finishes the request.
+   ----------------------------------------------------------------------- */
+int disk_read_real(int unit, int track, int first, int sectors, void *buffer)
+{
+    return diskReadWrite(DISK_READ, unit, track, first, sectors, buffer);
+} /* disk_read_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   disk_write_real
+   Purpose      -   Kernel-mode disk write for later phases.
+   Parameters   -   unit - Disk unit.
+                    track - Starting track.
+                    first - Starting sector.
+                    sectors - Total sectors.
+                    buffer - Memory address to write from.
+   Returns      -   See diskReadWrite.
+   Side Effects -   Blocks until the disk driver finishes the request.
+   ----------------------------------------------------------------------- */
+int disk_write_real(int unit, int track, int first, int sectors, void *buffer)
+{
+    return diskReadWrite(DISK_WRITE, unit, track, first, sectors, buffer);
+} /* disk_write_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   disk_size_real
+   Purpose      -   Kernel-mode disk size for later phases.
+   Parameters   -   unit - Disk unit.
+                    sector - Sector size.
+                    track - Track size.
+                    disk - Total tracks per disk.
+   Returns      -   See diskSize_real.
+   Side Effects -   
+   ----------------------------------------------------------------------- */
+int disk_size_real(int unit, int *sector, int *track, int *disk)
+{
+    return diskSize_real(unit, sector, track, disk);
+} /* disk_size_real */
+
+
 /* ------------------------------------------------------------------------
    Name         -   sysCall4
    Purpose      -   Manages all the system calls for phase4.
@@ -875,25 +930,47 @@ static void *ListGetNextNode(List *pList,  void *pCurrentStucture)
 
 
 /* ------------------------------------------------------------------------
-   Name         -   InitDriverTable
-   Purpose      -   memsets each index of the Driver_Table and assigns an 
-                    mbox_id.
-   Parameters   -   None
+   Name         -   InitDriverProc
+   Purpose      -   Sets up a new Driver_Table entry. Called on each entry
+                    of a chunk when the Driver_Table grows.
+   Parameters   -   pEntry - The entry, already zero-filled.
    Returns      -   None
-   Side Effects - 
+   Side Effects -   
    ----------------------------------------------------------------------- */
-void InitDriverTable()
+static void InitDriverProc(void *pEntry)
 {   
-    // Clear junk values from the Driver_Table at index i.
-    for (int i = 0; i < MAXPROC; i++)
+    proc_ptr driver_ptr = pEntry;
+
+    driver_ptr->sem_id = -1;
+} /* InitDriverProc */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   RequestSemaphore
+   Purpose      -   Gives a Driver_Table entry the semaphore its process
+                    blocks on until a driver finishes its request. Only
+                    entries that are used get one, and they keep it for
+                    the next process in the slot.
+   Parameters   -   driver_ptr - The entry.
+                    procName - Caller, for the error message.
+   Returns      -   None
+   Side Effects -   Halts if phase 3 is out of semaphores.
+   ----------------------------------------------------------------------- */
+static void RequestSemaphore(proc_ptr driver_ptr, char *procName)
+{
+    if (driver_ptr->sem_id != -1)
+    {
+        return;
+    }
+
+    driver_ptr->sem_id = semcreate_real(0);
+
+    if (driver_ptr->sem_id < 0)
     {
-        memset(&Driver_Table[i], 0, sizeof(Driver_Table[i]));
-        Driver_Table[i].disk_buf = NULL;
-        Driver_Table[i].next_ptr = NULL;
-        Driver_Table[i].prev_ptr = NULL;
-        Driver_Table[i].sem_id = semcreate_real(0);
+        console("%s(): Out of semaphores! Halting...\n", procName);
+        halt(1);
     }
-} /* InitTables */
+} /* RequestSemaphore */
 
 
 /* ------------------------------------------------------------------------
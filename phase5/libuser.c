@@ -0,0 +1,466 @@
+/*
+ *  File:  libuser.c
+ *
+ *  Description:  This file contains the interface declarations
+ *                to the phase 5 virtual memory system.
+ *
+ */
+
+#include <stdlib.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <usyscall.h>
+#include <usloss.h>
+#include <phase5.h>
+
+/*
+ * User heap. Each process keeps its allocator state in the reserved page
+ * at the top of its own VM region, so every process gets a private
+ * cache of free lists without any locking. Small requests are rounded
+ * up to a power-of-two size class and served from those lists; the
+ * kernel is only asked for pages HEAP_GROW at a time.
+ */
+#define HEAP_MAGIC      0x48656170  // Marks the start of a span.
+#define NUM_CLASSES     8           // 16, 32, ... 2048 bytes.
+#define MIN_CLASS_SIZE  16
+#define HEAP_GROW       4           // Pages requested per HeapAlloc.
+#define LARGE_CLASS     -1          // Span is a single large allocation.
+
+typedef struct HeapSpan
+{
+    int magic;
+    int sizeClass;  // Size class of the span's objects, or LARGE_CLASS.
+    int pages;      // Length of the span (in pages).
+    int pad;        // Keeps objects 16-byte aligned.
+} HeapSpan; // Header at the start of every heap page.
+
+typedef struct HeapState
+{
+    void *freeList[NUM_CLASSES];    // Free objects of each size class.
+    char *spare;                    // Next unused page from the kernel.
+    int spareCount;                 // Unused pages left at spare.
+} HeapState; // Per-process allocator state.
+
+static char *vmRegionBase;          // VM region, recorded by VmInit.
+static int vmRegionPages;           // Size of the VM region (in pages).
+
+static HeapState *GetHeapState(void);
+static void *SpanAlloc(HeapState *pState);
+
+#define CHECKMODE {						\
+	if (psr_get() & PSR_CURRENT_MODE) { 				\
+	    console("Trying to invoke syscall from kernel\n");	\
+	    halt(1);						\
+	}							\
+}
+
+
+/*
+ *  Routine:  VmInit
+ *
+ *  Description: This is the call entry point to start the virtual
+ *               memory system with clock page replacement.
+ *
+ *  Arguments:    int mappings -- checked to be positive, otherwise
+ *                                ignored; the MMU always has room to
+ *                                map every page of every process
+ *                int pages    -- size of the VM region (in pages)
+ *                int frames   -- size of physical memory (in frames)
+ *                int pagers   -- number of pager processes
+ *
+ *  Return Value: address of the VM region, NULL means error occurs
+ *
+ */
+void *VmInit(int mappings, int pages, int frames, int pagers)
+{
+    return VmInitPolicy(mappings, pages, frames, pagers, VM_CLOCK);
+} /* end of VmInit */
+
+
+/*
+ *  Routine:  VmInitPolicy
+ *
+ *  Description: This is the call entry point to start the virtual
+ *               memory system with a given page replacement policy.
+ *
+ *  Arguments:    int mappings -- checked to be positive, otherwise
+ *                                ignored; the MMU always has room to
+ *                                map every page of every process
+ *                int pages    -- size of the VM region (in pages)
+ *                int frames   -- size of physical memory (in frames)
+ *                int pagers   -- number of pager processes
+ *                int policy   -- VM_CLOCK, VM_ENHANCED_CLOCK, VM_LRU
+ *                                or VM_WSCLOCK
+ *
+ *  Return Value: address of the VM region, NULL means error occurs
+ *
+ */
+void *VmInitPolicy(int mappings, int pages, int frames, int pagers, int policy)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_VMINIT;
+    sa.arg1 = (void *) mappings;
+    sa.arg2 = (void *) pages;
+    sa.arg3 = (void *) frames;
+    sa.arg4 = (void *) pagers;
+    sa.arg5 = (void *) policy;
+    usyscall(&sa);
+
+    if (sa.arg1 != NULL)
+    {
+        vmRegionBase = sa.arg1;
+        vmRegionPages = pages;
+    }
+
+    return sa.arg1;
+} /* end of VmInitPolicy */
+
+
+/*
+ *  Routine:  VmCleanup
+ *
+ *  Description: This is the call entry point to shut down the virtual
+ *               memory system and print its statistics.
+ *
+ *  Arguments:    None
+ *
+ *  Return Value: None
+ *
+ */
+void VmCleanup(void)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_VMDESTROY;
+    usyscall(&sa);
+    vmRegionBase = NULL;
+} /* end of VmCleanup */
+
+/*
+ *  Routine:  VmShare
+ *
+ *  Description: This is the call entry point to share pages of the
+ *               VM region with another process.
+ *
+ *  Arguments:    int pid   -- process to share with; it must not have
+ *                             touched the pages yet
+ *                int page  -- first page to share
+ *                int count -- number of pages
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmShare(int pid, int page, int count)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_SHARE;
+    sa.arg1 = (void *) pid;
+    sa.arg2 = (void *) page;
+    sa.arg3 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of VmShare */
+
+
+/*
+ *  Routine:  VmCow
+ *
+ *  Description: This is the call entry point to give another process a
+ *               copy-on-write copy of pages of the VM region.
+ *
+ *  Arguments:    int pid   -- process to share with; it must not have
+ *                             touched the pages yet
+ *                int page  -- first page to share
+ *                int count -- number of pages
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmCow(int pid, int page, int count)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_COW;
+    sa.arg1 = (void *) pid;
+    sa.arg2 = (void *) page;
+    sa.arg3 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of VmCow */
+
+/*
+ *  Routine:  HeapAlloc
+ *
+ *  Description: This is the call entry point to grow the process's heap.
+ *
+ *  Arguments:    int pages -- number of pages to add
+ *
+ *  Return Value: address of the new pages, NULL means error occurs
+ *
+ */
+void *HeapAlloc(int pages)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_HEAPALLOC;
+    sa.arg2 = (void *) pages;
+    usyscall(&sa);
+    return sa.arg1;
+} /* end of HeapAlloc */
+
+
+/*
+ *  Routine:  HeapFree
+ *
+ *  Description: This is the call entry point to give heap pages back.
+ *
+ *  Arguments:    void *addr -- first page, as returned by HeapAlloc
+ *                int pages  -- number of pages
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int HeapFree(void *addr, int pages)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_HEAPFREE;
+    sa.arg1 = addr;
+    sa.arg2 = (void *) pages;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of HeapFree */
+
+
+/*
+ *  Routine:  VmGetStats
+ *
+ *  Description: This is the call entry point to read the paging
+ *               statistics of the current, or else the last, VM session.
+ *
+ *  Arguments:    VmStats *stats -- filled in with the statistics
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int VmGetStats(VmStats *stats)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_VMSTATS;
+    sa.arg1 = stats;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of VmGetStats */
+
+
+/*
+ *  Routine:  VmGetProcStats
+ *
+ *  Description: This is the call entry point to read the paging
+ *               statistics of one process.
+ *
+ *  Arguments:    int pid              -- the process
+ *                VmProcStats *procStats -- filled in with the statistics
+ *
+ *  Return Value: 0 means success, -1 means the process has no VM state
+ *
+ */
+int VmGetProcStats(int pid, VmProcStats *procStats)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_VMPROCSTATS;
+    sa.arg1 = procStats;
+    sa.arg2 = (void *) pid;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of VmGetProcStats */
+
+
+/*
+ *  Routine:  Malloc
+ *
+ *  Description: Allocates memory from the process's heap. Requests of
+ *               up to half a page never trap once the size class has
+ *               a free object.
+ *
+ *  Arguments:    int size -- number of bytes
+ *
+ *  Return Value: the memory, NULL means error occurs
+ *
+ */
+void *Malloc(int size)
+{
+    HeapState *pState;
+    HeapSpan *pSpan;
+    void *pObj;
+    int pageSize = USLOSS_MmuPageSize();
+    int sizeClass = 0;
+
+    if (size < 1 || vmRegionBase == NULL)
+    {
+        return NULL;
+    }
+
+    while (sizeClass < NUM_CLASSES && (MIN_CLASS_SIZE << sizeClass) < size)
+    {
+        sizeClass++;
+    }
+
+    // Large requests get pages of their own.
+    if (sizeClass == NUM_CLASSES)
+    {
+        int pages = (size + sizeof(HeapSpan) + pageSize - 1) / pageSize;
+
+        pSpan = HeapAlloc(pages);
+
+        if (pSpan == NULL)
+        {
+            return NULL;
+        }
+
+        pSpan->magic = HEAP_MAGIC;
+        pSpan->sizeClass = LARGE_CLASS;
+        pSpan->pages = pages;
+        return pSpan + 1;
+    }
+
+    pState = GetHeapState();
+
+    // Carve a fresh page into objects of this class.
+    if (pState->freeList[sizeClass] == NULL)
+    {
+        int objSize = MIN_CLASS_SIZE << sizeClass;
+        char *pNext;
+
+        pSpan = SpanAlloc(pState);
+
+        if (pSpan == NULL)
+        {
+            return NULL;
+        }
+
+        pSpan->magic = HEAP_MAGIC;
+        pSpan->sizeClass = sizeClass;
+        pSpan->pages = 1;
+
+        for (pNext = (char *) pSpan + pageSize - objSize;
+             pNext >= (char *) (pSpan + 1); pNext -= objSize)
+        {
+            *(void **) pNext = pState->freeList[sizeClass];
+            pState->freeList[sizeClass] = pNext;
+        }
+    }
+
+    pObj = pState->freeList[sizeClass];
+    pState->freeList[sizeClass] = *(void **) pObj;
+    return pObj;
+} /* end of Malloc */
+
+
+/*
+ *  Routine:  Free
+ *
+ *  Description: Returns memory from Malloc to the process's heap.
+ *
+ *  Arguments:    void *ptr -- memory from Malloc, or NULL
+ *
+ *  Return Value: None
+ *
+ */
+void Free(void *ptr)
+{
+    HeapState *pState;
+    HeapSpan *pSpan;
+    int pageSize = USLOSS_MmuPageSize();
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    // Every object lies in the first page of its span.
+    pSpan = (HeapSpan *) ((char *) ptr - ((char *) ptr - vmRegionBase) % pageSize);
+
+    if (pSpan->magic != HEAP_MAGIC)
+    {
+        console("Free(): %p was not returned by Malloc\n", ptr);
+        Terminate(1);
+    }
+
+    if (pSpan->sizeClass == LARGE_CLASS)
+    {
+        HeapFree(pSpan, pSpan->pages);
+        return;
+    }
+
+    pState = GetHeapState();
+    *(void **) ptr = pState->freeList[pSpan->sizeClass];
+    pState->freeList[pSpan->sizeClass] = ptr;
+} /* end of Free */
+
+
+/*
+ *  Routine:  GetHeapState
+ *
+ *  Description: Finds the calling process's allocator state. The page
+ *               is zero-filled on first touch, which is an empty state.
+ *
+ *  Arguments:    None
+ *
+ *  Return Value: the state
+ *
+ */
+static HeapState *GetHeapState(void)
+{
+    return (HeapState *) (vmRegionBase +
+                          (vmRegionPages - HEAP_RESERVED) * USLOSS_MmuPageSize());
+} /* end of GetHeapState */
+
+
+/*
+ *  Routine:  SpanAlloc
+ *
+ *  Description: Takes one page for a size class, growing the heap by
+ *               HEAP_GROW pages when the spare pages run out.
+ *
+ *  Arguments:    HeapState *pState -- the process's allocator state
+ *
+ *  Return Value: the page, NULL means the heap is full
+ *
+ */
+static void *SpanAlloc(HeapState *pState)
+{
+    void *pPage;
+
+    if (pState->spareCount == 0)
+    {
+        pState->spare = HeapAlloc(HEAP_GROW);
+
+        if (pState->spare == NULL)
+        {
+            return NULL;
+        }
+
+        pState->spareCount = HEAP_GROW;
+    }
+
+    pPage = pState->spare;
+    pState->spare += USLOSS_MmuPageSize();
+    pState->spareCount--;
+    return pPage;
+} /* end of SpanAlloc */
+
+/* end libuser.c */
@@ -0,0 +1,28 @@
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase5.h>
+#include <vm.h>
+
+void
+p1_fork(int pid)
+{
+    VmProcFork(pid);
+}
+
+void
+p1_switch(int old, int new)
+{
+    // Give the incoming process its own view of the VM region.
+    if (vmRegion != NULL)
+    {
+        USLOSS_MmuSetTag(VmTag(new));
+        vmStats.switches++;
+    }
+}
+
+void
+p1_quit(int pid)
+{
+    VmProcRelease(pid);
+}
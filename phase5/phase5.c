@@ -0,0 +1,2396 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase4.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <provided_prototypes.h>
+#include <phase5.h>
+#include <vm.h>
+
+/* ------------------------- Prototypes ----------------------------------- */
+static int ClockAdvance(void);
+static int ChooseVictim(void);
+static int ClockVictim(void);
+static int ClusterPage(VmProc *pProc, int page, int block);
+static int CopyOnWrite(int pid, int page);
+static int EnhancedClockVictim(void);
+static int ExtentAlloc(int pid);
+static int FindSharedFrame(int page, int block);
+static int GetFrame(int zero);
+static int LruVictim(void);
+static int PageIn(int pid, int page);
+static int PageShared(PTE *pPTE);
+static int Pager(char *);
+static int PopFreeFrame(void);
+static int PrefetchFrame(int pid, int held);
+static int ProcAlive(int pid);
+static int Prefetchable(VmProc *pProc, int page, int block);
+static int ShareRange(int pid, int page, int count, int cow);
+static int WsClockVictim(void);
+static int Zeroer(char *);
+static int SwapAlloc(int pid, int page);
+static int SwapIO(int io, int block, int count, void *buffer);
+static PTE *SharerPTE(int slot, int page, int frame);
+static VmProc *FindVmProc(int pid);
+static VmProc *GetVmProc(int pid);
+static void InitVmProc(void *pEntry);
+static void check_kernel_mode(char *procName);
+static void Evict(int frame);
+static void FaultHandler(int type, void *arg);
+static void FreeFrame(int frame);
+static void NotePeaks(void);
+static void InitFrame(int frame, int pid, int page);
+static void MapPage(int pid, int page, int frame);
+static void PageOut(int frame, int cluster);
+static void PrintStats(void);
+static void ReleaseFrame(int frame, int pid);
+static void ReleasePage(VmProc *pProc, int page);
+static void ReleaseVmProc(VmProc *pProc);
+static void SampleAccess(void);
+static void SwapFree(int block);
+static void SwapIn(int pid, int page, int frame);
+static void vmDestroy(sysargs *pSysarg);
+static void vmHeap(sysargs *pSysarg);
+static void vmInit(sysargs *pSysarg);
+static void vmShare(sysargs *pSysarg);
+static void vmStatsCall(sysargs *pSysarg);
+static void vmTerminate(sysargs *pSysarg);
+static void ProcStats(VmProc *pProc, VmProcStats *pProcStats);
+
+/* -------------------------- Globals ------------------------------------- */
+VmStats vmStats;                    // Paging statistics.
+void *vmRegion = NULL;              // Start of the VM region, NULL if VmInit wasn't called.
+static proc_table vmProcs =         // Per-process page tables.
+    { sizeof(VmProc), InitVmProc };
+static int numSlots;                // Slots given VM state since VmInit.
+static proc_table livePids =        // Pid phase1 last forked into each
+    { sizeof(int), NULL };          // slot, 0 once it calls Terminate.
+static FTE *frameTable;             // One entry per frame.
+static int *blockRefs;              // Page tables holding each swap block.
+static int *extentOwner;            // Process holding each swap extent, or -1.
+static int numExtents;              // Whole extents in the swap area.
+static char *pageBuffer;            // Staging buffer for swap I/O, one cluster long.
+static char *copyBuffer;            // Staging buffer for copy-on-write.
+static char *zeroPage;              // A page of zeroes for new pages.
+static int freeFrameList;           // First free frame that may hold old data, or -1.
+static int zeroFrameList;           // First free frame known to be zeroed, or -1.
+static int clockHand;               // Next frame the clock algorithm looks at.
+static int vmPolicy;                // Page replacement policy, VM_CLOCK etc.
+static int pageSize;                // Size of a page (in bytes).
+static int sectorSize;              // Size of a swap disk sector (in bytes).
+static int sectorsPerTrack;         // Sectors in each swap disk track.
+static int sectorsPerPage;          // Sectors that hold one page.
+static int faultMbox;               // Fault handler sends FaultMsgs here.
+static int vmMutex;                 // Protects the frame table, swap map and page tables.
+static int numPagers;               // Number of pager processes.
+static int pagerPids[MAXPAGERS];    // Pager processes.
+static int zeroerPid;               // Process that zeroes free frames.
+static int zeroerSem;               // Counts frames put on freeFrameList.
+static int zeroerQuit;              // Tells the zeroer to quit.
+static VmProcStats procLog[MAXPROC];// Statistics of processes that quit.
+static int procLogCount;            // Processes that quit since VmInit.
+static void (*terminateHandler)(sysargs *); // phase3's Terminate handler.
+
+
+/* ------------------------------------------------------------------------
+   Name         -   start4
+   Purpose      -   Installs the VM system calls and spawns start5.
+   Parameters   -   arg - Function argument.
+   Returns      -   Never returns, terminates with start5's status.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+int start4(char *arg)
+{
+    int pid;
+    int result;
+    int status;
+
+    // Initialize sys_vec with the VM syscalls.
+    sys_vec[SYS_VMINIT] = vmInit;
+    sys_vec[SYS_VMDESTROY] = vmDestroy;
+    sys_vec[SYS_SHARE] = vmShare;
+    sys_vec[SYS_COW] = vmShare;
+    sys_vec[SYS_HEAPALLOC] = vmHeap;
+    sys_vec[SYS_HEAPFREE] = vmHeap;
+    sys_vec[SYS_VMSTATS] = vmStatsCall;
+    sys_vec[SYS_VMPROCSTATS] = vmStatsCall;
+
+    // The phase1 library's quit never reaches p1_quit, so let go of a
+    // process's VM state on its way through Terminate.
+    terminateHandler = sys_vec[SYS_TERMINATE];
+    sys_vec[SYS_TERMINATE] = vmTerminate;
+
+    result = Spawn("start5", start5, NULL, 8 * USLOSS_MIN_STACK, 2, &pid);
+
+    // Error checking if something went wrong.
+    if (result != 0)
+    {
+        console("start4(): Error spawning start5\n");
+        Terminate(1);
+    }
+
+    Wait(&pid, &status);
+    Terminate(status);
+
+    return 0;
+} /* start4 */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vmInit
+   Purpose      -   Syscall handler for VmInit.
+   Parameters   -   *pSysarg - arg1 mappings, arg2 pages, arg3 frames,
+                               arg4 pagers, arg5 replacement policy.
+   Returns      -   None, arg1 is the VM region and arg4 is zero or an
+                    error code.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void vmInit(sysargs *pSysarg)
+{
+    void *region;
+
+    region = vm_init_real((int) pSysarg->arg1, (int) pSysarg->arg2,
+                          (int) pSysarg->arg3, (int) pSysarg->arg4,
+                          (int) pSysarg->arg5);
+
+    if ((long) region < 0)
+    {
+        pSysarg->arg1 = NULL;
+        pSysarg->arg4 = region;
+    }
+
+    else
+    {
+        pSysarg->arg1 = region;
+        pSysarg->arg4 = (void *) 0;
+    }
+
+    // Switch to user mode.
+    psr_set(psr_get() & ~PSR_CURRENT_MODE);
+} /* vmInit */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vmDestroy
+   Purpose      -   Syscall handler for VmCleanup.
+   Parameters   -   *pSysarg - Unused.
+   Returns      -   None
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void vmDestroy(sysargs *pSysarg)
+{
+    vm_cleanup_real();
+
+    // Switch to user mode.
+    psr_set(psr_get() & ~PSR_CURRENT_MODE);
+} /* vmDestroy */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vmTerminate
+   Purpose      -   Syscall handler for Terminate. Releases the caller's VM
+                    state, then passes the call on to phase3.
+   Parameters   -   *pSysarg - Passed on unchanged.
+   Returns      -   Never returns.
+   Side Effects -   The caller's frames go to the zeroer and its pid no
+                    longer counts as alive for ShareRange.
+   ----------------------------------------------------------------------- */
+static void vmTerminate(sysargs *pSysarg)
+{
+    int pid = getpid();
+    int *pLivePid = proc_entry(&livePids, pid);
+
+    VmProcRelease(pid);
+
+    if (pLivePid != NULL)
+    {
+        *pLivePid = 0;
+    }
+
+    (*terminateHandler)(pSysarg);
+} /* vmTerminate */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vmShare
+   Purpose      -   Syscall handler for VmShare and VmCow.
+   Parameters   -   *pSysarg - arg1 pid, arg2 page, arg3 count.
+   Returns      -   None, arg4 is zero or -1.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void vmShare(sysargs *pSysarg)
+{
+    int result;
+
+    result = ShareRange((int) pSysarg->arg1, (int) pSysarg->arg2,
+                        (int) pSysarg->arg3, pSysarg->number == SYS_COW);
+    pSysarg->arg4 = (void *) result;
+    NotePeaks();
+
+    // Switch to user mode.
+    psr_set(psr_get() & ~PSR_CURRENT_MODE);
+} /* vmShare */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vmHeap
+   Purpose      -   Syscall handler for HeapAlloc and HeapFree.
+   Parameters   -   *pSysarg - arg1 address (HeapFree only), arg2 pages.
+   Returns      -   None, arg1 is the new pages (HeapAlloc only) and arg4
+                    is zero or -1.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void vmHeap(sysargs *pSysarg)
+{
+    if (vmRegion == NULL)
+    {
+        pSysarg->arg1 = NULL;
+        pSysarg->arg4 = (void *) -1;
+    }
+
+    else if (pSysarg->number == SYS_HEAPALLOC)
+    {
+        pSysarg->arg1 = heap_alloc_real((int) pSysarg->arg2);
+        pSysarg->arg4 = (void *) (pSysarg->arg1 == NULL ? -1 : 0);
+    }
+
+    else
+    {
+        pSysarg->arg4 = (void *) heap_free_real(pSysarg->arg1, (int) pSysarg->arg2);
+    }
+
+    // Switch to user mode.
+    psr_set(psr_get() & ~PSR_CURRENT_MODE);
+} /* vmHeap */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vmStatsCall
+   Purpose      -   Syscall handler for VmGetStats and VmGetProcStats.
+   Parameters   -   *pSysarg - arg1 buffer to fill, arg2 pid
+                               (VmGetProcStats only).
+   Returns      -   None, arg4 is zero or -1.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void vmStatsCall(sysargs *pSysarg)
+{
+    int result;
+
+    if (pSysarg->number == SYS_VMSTATS)
+    {
+        result = vm_stats_real(pSysarg->arg1);
+    }
+
+    else
+    {
+        result = vm_proc_stats_real((int) pSysarg->arg2, pSysarg->arg1);
+    }
+
+    pSysarg->arg4 = (void *) result;
+
+    // Switch to user mode.
+    psr_set(psr_get() & ~PSR_CURRENT_MODE);
+} /* vmStatsCall */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vm_init_real
+   Purpose      -   Initializes the MMU, the frame table and the swap area
+                    and forks the pagers.
+   Parameters   -   mappings - Must be positive, otherwise ignored.
+                    pages - Size of the VM region (in pages).
+                    frames - Size of physical memory (in frames).
+                    pagers - Number of pager processes.
+                    policy - Page replacement policy, VM_CLOCK etc.
+   Returns      -   The VM region, VM_ERR_INVALID for bad arguments or
+                    VM_ERR_ACTIVE if the VM system is already running.
+   Side Effects -   Every process gets a private copy of the region.
+   ----------------------------------------------------------------------- */
+void *vm_init_real(int mappings, int pages, int frames, int pagers, int policy)
+{
+    char name[128];
+    int diskTracks;
+    int dummy;
+    int result;
+
+    check_kernel_mode("vm_init_real");
+
+    if (vmRegion != NULL)
+    {
+        return (void *) VM_ERR_ACTIVE;
+    }
+
+    if (mappings < 1 || pages < 1 || frames < 1 || pagers < 1 ||
+        pagers > MAXPAGERS || policy < VM_CLOCK || policy > VM_WSCLOCK)
+    {
+        return (void *) VM_ERR_INVALID;
+    }
+
+    // One tag per process slot. Shared frames are mapped into several
+    // tags at once, so allow for every page of every process whatever
+    // mappings says; with less, the MMU would refuse some mappings.
+    if (USLOSS_MmuSetNumTags(VM_NUM_TAGS) != USLOSS_MMU_OK)
+    {
+        return (void *) VM_ERR_INVALID;
+    }
+
+    result = USLOSS_MmuInit(pages * VM_NUM_TAGS, pages, frames);
+
+    if (result != USLOSS_MMU_OK)
+    {
+        return (void *) VM_ERR_INVALID;
+    }
+
+    int_vec[MMU_INT] = FaultHandler;
+    pageSize = USLOSS_MmuPageSize();
+
+    // Page tables are allocated by GetVmProc as processes first fault.
+    numSlots = 0;
+
+    // Every frame starts out on the free list for the zeroer to clear.
+    frameTable = malloc(frames * sizeof(FTE));
+
+    for (int i = 0; i < frames; i++)
+    {
+        frameTable[i].pid = -1;
+        frameTable[i].page = -1;
+        frameTable[i].next = i + 1 < frames ? i + 1 : -1;
+        frameTable[i].refs = 0;
+        frameTable[i].age = 0;
+        frameTable[i].lastUse = 0;
+    }
+
+    freeFrameList = 0;
+    zeroFrameList = -1;
+    procLogCount = 0;
+    clockHand = 0;
+    vmPolicy = policy;
+
+    // Carve the swap disk into page-sized blocks.
+    disk_size_real(SWAP_DISK, &sectorSize, &sectorsPerTrack, &diskTracks);
+    sectorsPerPage = pageSize / sectorSize;
+    memset(&vmStats, 0, sizeof(vmStats));
+    vmStats.pages = pages;
+    vmStats.frames = frames;
+    vmStats.blocks = diskTracks * sectorsPerTrack / sectorsPerPage;
+    vmStats.freeFrames = frames;
+    vmStats.freeBlocks = vmStats.blocks;
+    blockRefs = calloc(vmStats.blocks, sizeof(int));
+    numExtents = vmStats.blocks / SWAP_CLUSTER;
+    extentOwner = malloc(numExtents * sizeof(int));
+
+    for (int i = 0; i < numExtents; i++)
+    {
+        extentOwner[i] = -1;
+    }
+
+    pageBuffer = malloc(SWAP_CLUSTER * pageSize);
+    copyBuffer = malloc(pageSize);
+    zeroPage = calloc(pageSize, sizeof(char));
+
+    vmMutex = semcreate_real(1);
+    zeroerSem = semcreate_real(frames);
+    zeroerQuit = 0;
+    faultMbox = MboxCreate(MAXPROC, sizeof(FaultMsg));
+    vmRegion = USLOSS_MmuRegion(&dummy);
+
+    // Create the pager processes.
+    numPagers = pagers;
+
+    for (int i = 0; i < numPagers; i++)
+    {
+        sprintf(name, "Pager%d", i);
+        pagerPids[i] = fork1(name, Pager, NULL, USLOSS_MIN_STACK, PAGER_PRIORITY);
+
+        if (pagerPids[i] < 0)
+        {
+            console("vm_init_real(): Can't create pager %d\n", i);
+            halt(1);
+        }
+    }
+
+    zeroerPid = fork1("Zeroer", Zeroer, NULL, USLOSS_MIN_STACK, ZEROER_PRIORITY);
+
+    if (zeroerPid < 0)
+    {
+        console("vm_init_real(): Can't create the zeroer\n");
+        halt(1);
+    }
+
+    return vmRegion;
+} /* vm_init_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vm_cleanup_real
+   Purpose      -   Stops the pagers, releases the MMU and prints the
+                    paging statistics.
+   Parameters   -   None
+   Returns      -   None
+   Side Effects -   Does nothing if VmInit wasn't called.
+   ----------------------------------------------------------------------- */
+void vm_cleanup_real(void)
+{
+    FaultMsg msg;
+    VmProc *pProc;
+    int status;
+    int pid;
+    int reaped;
+
+    check_kernel_mode("vm_cleanup_real");
+
+    if (vmRegion == NULL)
+    {
+        return;
+    }
+
+    // Tell every pager and the zeroer to quit.
+    msg.pid = PAGER_QUIT;
+
+    for (int i = 0; i < numPagers; i++)
+    {
+        MboxSend(faultMbox, &msg, sizeof(msg));
+    }
+
+    zeroerQuit = 1;
+    semv_real(zeroerSem);
+
+    // Wait for each of them by pid before tearing anything down; zap
+    // returns at once for one that has already quit.
+    for (int i = 0; i < numPagers; i++)
+    {
+        zap(pagerPids[i]);
+    }
+
+    zap(zeroerPid);
+
+    // Reap them, so a later Wait can't return one. join takes the oldest
+    // quit child first, and they quit last.
+    reaped = 0;
+
+    while (reaped < numPagers + 1 && (pid = join(&status)) > 0)
+    {
+        if (pid == zeroerPid)
+        {
+            reaped++;
+        }
+
+        for (int i = 0; i < numPagers; i++)
+        {
+            if (pid == pagerPids[i])
+            {
+                reaped++;
+            }
+        }
+    }
+
+    // Drop whatever is still mapped.
+    for (int i = 0; i < numSlots; i++)
+    {
+        pProc = proc_table_entry(&vmProcs, i);
+
+        if (pProc->pid != -1)
+        {
+            VmProcRelease(pProc->pid);
+        }
+    }
+
+    PrintStats();
+
+    // Stop p1_switch from retagging before the MMU goes away.
+    vmRegion = NULL;
+    USLOSS_MmuDone();
+    MboxRelease(faultMbox);
+    semfree_real(vmMutex);
+    semfree_real(zeroerSem);
+
+    for (int i = 0; i < numSlots; i++)
+    {
+        pProc = proc_table_entry(&vmProcs, i);
+        free(pProc->pageTable);
+        free(pProc->extents);
+        pProc->pageTable = NULL;
+        pProc->extents = NULL;
+    }
+
+    free(frameTable);
+    free(blockRefs);
+    free(extentOwner);
+    free(pageBuffer);
+    free(copyBuffer);
+    free(zeroPage);
+} /* vm_cleanup_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   VmProcRelease
+   Purpose      -   Frees the frames and swap blocks of a process and
+                    unmaps its pages.
+   Parameters   -   pid - The process that is quitting.
+   Returns      -   None
+   Side Effects -   Called from Terminate and p1_quit.
+   ----------------------------------------------------------------------- */
+void VmProcRelease(int pid)
+{
+    VmProc *pProc;
+
+    if (vmRegion == NULL || (pProc = FindVmProc(pid)) == NULL ||
+        pProc->pid != pid)
+    {
+        return;
+    }
+
+    semp_real(vmMutex);
+    ReleaseVmProc(pProc);
+    semv_real(vmMutex);
+} /* VmProcRelease */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ReleaseVmProc
+   Purpose      -   Does the work of VmProcRelease.
+   Parameters   -   pProc - The process's entry.
+   Returns      -   None
+   Side Effects -   Caller holds vmMutex. The entry is free again.
+   ----------------------------------------------------------------------- */
+static void ReleaseVmProc(VmProc *pProc)
+{
+    // Keep the process's numbers for VmCleanup to print.
+    if (procLogCount < MAXPROC)
+    {
+        ProcStats(pProc, &procLog[procLogCount]);
+    }
+
+    procLogCount++;
+
+    for (int page = 0; page < pProc->numPages; page++)
+    {
+        ReleasePage(pProc, page);
+    }
+
+    for (int group = 0; group * SWAP_CLUSTER < pProc->numPages; group++)
+    {
+        if (pProc->extents[group] != -1)
+        {
+            extentOwner[pProc->extents[group]] = -1;
+        }
+    }
+
+    MboxRelease(pProc->replyMbox);
+    pProc->replyMbox = -1;
+    pProc->pid = -1;
+} /* ReleaseVmProc */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ReleasePage
+   Purpose      -   Drops a page from a process, so the next touch
+                    zero-fills it.
+   Parameters   -   pProc - The process.
+                    page - The page.
+   Returns      -   None
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static void ReleasePage(VmProc *pProc, int page)
+{
+    PTE *pPTE = &pProc->pageTable[page];
+    int access;
+
+    if (pPTE->state == INCORE)
+    {
+        USLOSS_MmuUnmap(VmTag(pProc->pid), page);
+
+        // Sharers waiting in swap need what this process wrote.
+        if (frameTable[pPTE->frame].refs == 1 && pPTE->block != -1 &&
+            blockRefs[pPTE->block] > 1)
+        {
+            USLOSS_MmuGetAccess(pPTE->frame, &access);
+
+            if (access & USLOSS_MMU_DIRTY)
+            {
+                PageOut(pPTE->frame, 0);
+            }
+        }
+
+        ReleaseFrame(pPTE->frame, pProc->pid);
+    }
+
+    if (pPTE->block != -1)
+    {
+        SwapFree(pPTE->block);
+    }
+
+    pPTE->state = UNUSED;
+    pPTE->frame = -1;
+    pPTE->block = -1;
+    pPTE->cow = 0;
+} /* ReleasePage */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   heap_alloc_real
+   Purpose      -   Gives the calling process a run of heap pages, reusing
+                    a freed hole when one fits and otherwise growing the
+                    heap down from the top of the VM region.
+   Parameters   -   pages - Number of pages.
+   Returns      -   Address of the pages, or NULL if the region is used up.
+   Side Effects -   The pages are zero-filled on first touch.
+   ----------------------------------------------------------------------- */
+void *heap_alloc_real(int pages)
+{
+    VmProc *pProc;
+    void *addr = NULL;
+    int top, run = 0;
+    int page = -1;
+
+    semp_real(vmMutex);
+
+    pProc = GetVmProc(getpid());
+    top = pProc->numPages - HEAP_RESERVED;
+
+    // First fit among the holes freed inside the heap.
+    for (int i = pProc->heapBreak; pages > 0 && i < top && page == -1; i++)
+    {
+        run = pProc->pageTable[i].heap ? 0 : run + 1;
+
+        if (run == pages)
+        {
+            page = i - pages + 1;
+        }
+    }
+
+    // Otherwise grow the heap down, absorbing a hole at its bottom.
+    if (page == -1 && pages > 0)
+    {
+        for (run = 0; pProc->heapBreak + run < top &&
+             ! pProc->pageTable[pProc->heapBreak + run].heap; run++)
+        {
+        }
+
+        if (pages - run <= pProc->heapBreak)
+        {
+            pProc->heapBreak -= pages - run;
+            page = pProc->heapBreak;
+        }
+    }
+
+    if (page != -1)
+    {
+        for (int i = page; i < page + pages; i++)
+        {
+            pProc->pageTable[i].heap = 1;
+        }
+
+        addr = (char *) vmRegion + page * pageSize;
+    }
+
+    vmStats.heapCalls++;
+    semv_real(vmMutex);
+    return addr;
+} /* heap_alloc_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   heap_free_real
+   Purpose      -   Gives heap pages back, shrinking the heap when the free
+                    pages reach its bottom.
+   Parameters   -   addr - First page, as returned by heap_alloc_real.
+                    pages - Number of pages.
+   Returns      -   Zero, or -1 if the pages aren't allocated heap pages.
+   Side Effects -   The pages' frames and swap blocks are freed.
+   ----------------------------------------------------------------------- */
+int heap_free_real(void *addr, int pages)
+{
+    VmProc *pProc;
+    long offset = (char *) addr - (char *) vmRegion;
+    int page = offset / pageSize;
+
+    semp_real(vmMutex);
+
+    pProc = GetVmProc(getpid());
+    vmStats.heapCalls++;
+
+    if (offset < 0 || offset % pageSize != 0 || pages < 1 ||
+        page < pProc->heapBreak || page + pages > pProc->numPages - HEAP_RESERVED)
+    {
+        semv_real(vmMutex);
+        return -1;
+    }
+
+    for (int i = page; i < page + pages; i++)
+    {
+        if (! pProc->pageTable[i].heap)
+        {
+            semv_real(vmMutex);
+            return -1;
+        }
+    }
+
+    for (int i = page; i < page + pages; i++)
+    {
+        ReleasePage(pProc, i);
+        pProc->pageTable[i].heap = 0;
+    }
+
+    // Pull the break up past any free pages now at the bottom.
+    while (pProc->heapBreak < pProc->numPages - HEAP_RESERVED &&
+           ! pProc->pageTable[pProc->heapBreak].heap)
+    {
+        pProc->heapBreak++;
+    }
+
+    semv_real(vmMutex);
+    return 0;
+} /* heap_free_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vm_stats_real
+   Purpose      -   Copies out the paging statistics.
+   Parameters   -   pStats - Where to put them.
+   Returns      -   Zero, or -1 if pStats is NULL.
+   Side Effects -   Still works after VmCleanup, giving the totals of the
+                    last VM session.
+   ----------------------------------------------------------------------- */
+int vm_stats_real(VmStats *pStats)
+{
+    if (pStats == NULL)
+    {
+        return -1;
+    }
+
+    *pStats = vmStats;
+    return 0;
+} /* vm_stats_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   vm_proc_stats_real
+   Purpose      -   Copies out the paging statistics of one process.
+   Parameters   -   pid - The process.
+                    pProcStats - Where to put them.
+   Returns      -   Zero, or -1 if the process has no VM state.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+int vm_proc_stats_real(int pid, VmProcStats *pProcStats)
+{
+    VmProc *pProc;
+
+    if (vmRegion == NULL || pProcStats == NULL ||
+        (pProc = FindVmProc(pid)) == NULL || pProc->pid != pid)
+    {
+        return -1;
+    }
+
+    semp_real(vmMutex);
+    ProcStats(pProc, pProcStats);
+    semv_real(vmMutex);
+    return 0;
+} /* vm_proc_stats_real */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ProcStats
+   Purpose      -   Counts up the paging statistics of a process.
+   Parameters   -   pProc - The process.
+                    pProcStats - Where to put them.
+   Returns      -   None
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static void ProcStats(VmProc *pProc, VmProcStats *pProcStats)
+{
+    pProcStats->pid = pProc->pid;
+    pProcStats->faults = pProc->faults;
+    pProcStats->resident = 0;
+    pProcStats->swapped = 0;
+
+    for (int page = 0; page < pProc->numPages; page++)
+    {
+        if (pProc->pageTable[page].state == INCORE)
+        {
+            pProcStats->resident++;
+        }
+
+        else if (pProc->pageTable[page].state == ONDISK)
+        {
+            pProcStats->swapped++;
+        }
+    }
+} /* ProcStats */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   NotePeaks
+   Purpose      -   Records the high-water marks of frame and swap use.
+   Parameters   -   None
+   Returns      -   None
+   Side Effects -   Frames and blocks are only taken while a fault or a
+                    VmShare/VmCow is serviced, so sampling after each one
+                    catches every peak.
+   ----------------------------------------------------------------------- */
+static void NotePeaks(void)
+{
+    if (vmStats.frames - vmStats.freeFrames > vmStats.peakFrames)
+    {
+        vmStats.peakFrames = vmStats.frames - vmStats.freeFrames;
+    }
+
+    if (vmStats.blocks - vmStats.freeBlocks > vmStats.peakBlocks)
+    {
+        vmStats.peakBlocks = vmStats.blocks - vmStats.freeBlocks;
+    }
+} /* NotePeaks */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   VmProcFork
+   Purpose      -   Notes which process phase1 just put in a slot.
+   Parameters   -   pid - The new process.
+   Returns      -   None
+   Side Effects -   Called from p1_fork for every process.
+   ----------------------------------------------------------------------- */
+void VmProcFork(int pid)
+{
+    int *pLivePid = proc_entry(&livePids, pid);
+
+    if (pLivePid != NULL)
+    {
+        *pLivePid = pid;
+    }
+} /* VmProcFork */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ProcAlive
+   Purpose      -   Checks that a pid is the process phase1 last put in
+                    its slot. phase1 keeps its process table to itself,
+                    so VmProcFork mirrors the pid column.
+   Parameters   -   pid - The process.
+   Returns      -   Non-zero if the process owns its slot.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int ProcAlive(int pid)
+{
+    int *pLivePid = proc_entry(&livePids, pid);
+
+    return pLivePid != NULL && *pLivePid == pid;
+} /* ProcAlive */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   FindVmProc
+   Purpose      -   Finds the entry of a process's slot.
+   Parameters   -   pid - The process.
+   Returns      -   Pointer to the entry, or NULL if the process's slot
+                    has no MMU tag. The entry may belong to another pid.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static VmProc *FindVmProc(int pid)
+{
+    if (VmTag(pid) == VM_NO_TAG)
+    {
+        return NULL;
+    }
+
+    return proc_entry(&vmProcs, pid);
+} /* FindVmProc */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   GetVmProc
+   Purpose      -   Finds the VM state of a process, setting it up the
+                    first time the process faults.
+   Parameters   -   pid - The process.
+   Returns      -   Pointer to the process's entry.
+   Side Effects -   Caller holds vmMutex. Halts if the process's slot has
+                    no MMU tag.
+   ----------------------------------------------------------------------- */
+static VmProc *GetVmProc(int pid)
+{
+    VmProc *pProc = FindVmProc(pid);
+
+    if (pProc == NULL)
+    {
+        console("GetVmProc(): Process %d has no MMU tag! Halting...\n", pid);
+        halt(1);
+    }
+
+    if (pProc->pid != pid)
+    {
+        // A slot holds one process at a time, so the last one is gone even
+        // if it quit without going through Terminate.
+        if (pProc->pid != -1)
+        {
+            ReleaseVmProc(pProc);
+        }
+
+        if (pProc->pageTable == NULL)
+        {
+            pProc->numPages = vmStats.pages;
+            pProc->pageTable = malloc(pProc->numPages * sizeof(PTE));
+            pProc->extents = malloc((pProc->numPages + SWAP_CLUSTER - 1) /
+                                    SWAP_CLUSTER * sizeof(int));
+        }
+
+        if (VmTag(pid) >= numSlots)
+        {
+            numSlots = VmTag(pid) + 1;
+        }
+
+        for (int page = 0; page < pProc->numPages; page++)
+        {
+            pProc->pageTable[page].state = UNUSED;
+            pProc->pageTable[page].frame = -1;
+            pProc->pageTable[page].block = -1;
+            pProc->pageTable[page].cow = 0;
+            pProc->pageTable[page].heap = 0;
+        }
+
+        for (int group = 0; group * SWAP_CLUSTER < pProc->numPages; group++)
+        {
+            pProc->extents[group] = -1;
+        }
+
+        pProc->pid = pid;
+        pProc->heapBreak = pProc->numPages - HEAP_RESERVED;
+        pProc->replyMbox = MboxCreate(1, sizeof(int));
+        pProc->faults = 0;
+    }
+
+    return pProc;
+} /* GetVmProc */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   InitVmProc
+   Purpose      -   Sets up a new vmProcs entry. Called on each entry of a
+                    chunk when vmProcs grows.
+   Parameters   -   pEntry - The entry, already zero-filled.
+   Returns      -   None
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void InitVmProc(void *pEntry)
+{
+    VmProc *pProc = pEntry;
+
+    pProc->pid = -1;
+    pProc->replyMbox = -1;
+} /* InitVmProc */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   FaultHandler
+   Purpose      -   Handles an MMU interrupt by passing the fault to a
+                    pager and blocking until the page is mapped.
+   Parameters   -   type - MMU_INT
+                    arg - Offset of the fault within the VM region.
+   Returns      -   None
+   Side Effects -   The faulting process blocks. A write to a read-only
+                    page that isn't copy-on-write terminates it.
+   ----------------------------------------------------------------------- */
+static void FaultHandler(int type, void *arg)
+{
+    FaultMsg msg;
+    VmProc *pProc;
+    int cause;
+    int reply;
+    int start;
+
+    cause = USLOSS_MmuGetCause();
+
+    if (cause != USLOSS_MMU_FAULT && cause != USLOSS_MMU_ACCESS)
+    {
+        console("FaultHandler(): Process %d unexpected MMU cause %d\n",
+                getpid(), cause);
+        terminate_real(1);
+    }
+
+    start = sys_clock();
+    semp_real(vmMutex);
+    pProc = GetVmProc(getpid());
+    pProc->faults++;
+    vmStats.faults++;
+    semv_real(vmMutex);
+
+    // Hand the fault to a pager and wait for it to map the page.
+    msg.pid = pProc->pid;
+    msg.page = (int) ((long) arg / pageSize);
+    msg.cause = cause;
+    msg.replyMbox = pProc->replyMbox;
+    MboxSend(faultMbox, &msg, sizeof(msg));
+    MboxReceive(pProc->replyMbox, &reply, sizeof(reply));
+
+    vmStats.faultTime += sys_clock() - start;
+
+    if (reply < 0)
+    {
+        console("FaultHandler(): Process %d access violation at %p\n",
+                getpid(), arg);
+        terminate_real(1);
+    }
+} /* FaultHandler */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   Pager
+   Purpose      -   Services page faults until told to quit.
+   Parameters   -   arg - Function argument.
+   Returns      -   Zero
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int Pager(char *arg)
+{
+    FaultMsg msg;
+    int reply;
+
+    psr_set(psr_get() | PSR_CURRENT_INT);
+
+    while (! is_zapped())
+    {
+        // A zap while blocked leaves msg unfilled.
+        if (MboxReceive(faultMbox, &msg, sizeof(msg)) < 0 ||
+            msg.pid == PAGER_QUIT)
+        {
+            break;
+        }
+
+        semp_real(vmMutex);
+
+        // Approximate LRU ages every frame once per fault.
+        if (vmPolicy == VM_LRU)
+        {
+            SampleAccess();
+        }
+
+        if (msg.cause == USLOSS_MMU_ACCESS)
+        {
+            reply = CopyOnWrite(msg.pid, msg.page);
+        }
+
+        else
+        {
+            reply = PageIn(msg.pid, msg.page);
+        }
+
+        NotePeaks();
+        semv_real(vmMutex);
+
+        MboxSend(msg.replyMbox, &reply, sizeof(reply));
+    }
+
+    quit(0);
+    return 0;
+} /* Pager */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   Zeroer
+   Purpose      -   Clears free frames in the background so new pages can
+                    be mapped without zeroing a frame in the fault.
+   Parameters   -   arg - Unused.
+   Returns      -   Zero
+   Side Effects -   Moves frames from freeFrameList to zeroFrameList.
+   ----------------------------------------------------------------------- */
+static int Zeroer(char *arg)
+{
+    int frame;
+
+    psr_set(psr_get() | PSR_CURRENT_INT);
+
+    for (;;)
+    {
+        semp_real(zeroerSem);
+
+        if (zeroerQuit)
+        {
+            break;
+        }
+
+        semp_real(vmMutex);
+        frame = freeFrameList;
+
+        // The victim scans pass over the frame while it is off both
+        // lists. With a single frame they would have nothing else.
+        if (frame != -1 && vmStats.frames > 1)
+        {
+            freeFrameList = frameTable[frame].next;
+        }
+
+        else
+        {
+            frame = -1;
+        }
+
+        semv_real(vmMutex);
+
+        // GetFrame may have taken the frame already.
+        if (frame == -1)
+        {
+            continue;
+        }
+
+        // Off both lists, so nothing else can touch the frame while it is
+        // cleared through the kernel's view of physical memory.
+        USLOSS_MmuWriteFrame(frame, zeroPage);
+
+        semp_real(vmMutex);
+        frameTable[frame].next = zeroFrameList;
+        zeroFrameList = frame;
+        vmStats.zeroed++;
+        semv_real(vmMutex);
+    }
+
+    quit(0);
+    return 0;
+} /* Zeroer */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   PageIn
+   Purpose      -   Maps a page into a process, sharing the frame of a
+                    process that already has the page's swap block in
+                    memory, or else filling a frame from swap or with
+                    zeroes.
+   Parameters   -   pid - The process.
+                    page - The page.
+   Returns      -   Zero
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static int PageIn(int pid, int page)
+{
+    PTE *pPTE = &FindVmProc(pid)->pageTable[page];
+    int frame = -1;
+
+    // VmShare or VmCow may have mapped the page since the fault.
+    if (pPTE->state == INCORE)
+    {
+        return 0;
+    }
+
+    if (pPTE->state == ONDISK)
+    {
+        frame = FindSharedFrame(page, pPTE->block);
+    }
+
+    if (frame != -1)
+    {
+        frameTable[frame].refs++;
+    }
+
+    else
+    {
+        // Fill the frame with the page's contents.
+        if (pPTE->state == ONDISK)
+        {
+            frame = GetFrame(0);
+            SwapIn(pid, page, frame);
+            vmStats.pageIns++;
+        }
+
+        else
+        {
+            frame = GetFrame(1);
+            vmStats.newPages++;
+        }
+
+        InitFrame(frame, pid, page);
+    }
+
+    MapPage(pid, page, frame);
+    return 0;
+} /* PageIn */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   SwapIn
+   Purpose      -   Reads a page from swap, prefetching its neighbours in
+                    the same extent in the same disk request.
+   Parameters   -   pid - The process.
+                    page - The page that faulted.
+                    frame - Frame for the page.
+   Returns      -   None
+   Side Effects -   Prefetched pages are mapped unreferenced, so the
+                    replacement policy takes them first if they go unused.
+                    Frames for them may come from evicting the process's
+                    other pages.
+                    Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static void SwapIn(int pid, int page, int frame)
+{
+    VmProc *pProc = FindVmProc(pid);
+    int block = pProc->pageTable[page].block;
+    int group = page - page % SWAP_CLUSTER;
+    int frames[SWAP_CLUSTER];
+    int first = page;
+    int last = page;
+
+    frames[page - group] = frame;
+
+    // Under paging pressure the frames come from evictions. Until the read
+    // maps them, they have no references, so the scans leave them alone.
+    while (last + 1 < group + SWAP_CLUSTER &&
+           Prefetchable(pProc, last + 1, block + last + 1 - page))
+    {
+        if ((frames[last + 1 - group] = PrefetchFrame(pid, last - first + 1)) == -1)
+        {
+            break;
+        }
+
+        last++;
+    }
+
+    while (first > group && Prefetchable(pProc, first - 1, block - (page - first + 1)))
+    {
+        if ((frames[first - 1 - group] = PrefetchFrame(pid, last - first + 1)) == -1)
+        {
+            break;
+        }
+
+        first--;
+    }
+
+    SwapIO(DISK_READ, block - (page - first), last - first + 1, pageBuffer);
+
+    for (int i = first; i <= last; i++)
+    {
+        USLOSS_MmuWriteFrame(frames[i - group], pageBuffer + (i - first) * pageSize);
+
+        if (i != page)
+        {
+            InitFrame(frames[i - group], pid, i);
+            frameTable[frames[i - group]].age = 0;
+            MapPage(pid, i, frames[i - group]);
+            vmStats.prefetched++;
+        }
+    }
+} /* SwapIn */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   Prefetchable
+   Purpose      -   Checks whether a page can be read along with a
+                    neighbour whose swap run would put it at a given block.
+   Parameters   -   pProc - The process.
+                    page - The page.
+                    block - Block the run would read it from.
+   Returns      -   1 if the page is only in swap, at that block.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int Prefetchable(VmProc *pProc, int page, int block)
+{
+    PTE *pPTE;
+
+    if (page >= pProc->numPages)
+    {
+        return 0;
+    }
+
+    pPTE = &pProc->pageTable[page];
+
+    return pPTE->state == ONDISK && pPTE->block == block &&
+           FindSharedFrame(page, block) == -1;
+} /* Prefetchable */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   InitFrame
+   Purpose      -   Gives a frame to a page that has just been filled in.
+   Parameters   -   frame - The frame.
+                    pid - The process.
+                    page - The page.
+   Returns      -   None
+   Side Effects -   Clears the frame's old access bits.
+   ----------------------------------------------------------------------- */
+static void InitFrame(int frame, int pid, int page)
+{
+    USLOSS_MmuSetAccess(frame, 0);
+    frameTable[frame].pid = pid;
+    frameTable[frame].page = page;
+    frameTable[frame].refs = 1;
+    frameTable[frame].age = LRU_AGE_NEW;
+    frameTable[frame].lastUse = vmStats.faults;
+} /* InitFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   MapPage
+   Purpose      -   Maps a page of a process to the frame holding it.
+   Parameters   -   pid - The process.
+                    page - The page.
+                    frame - The frame.
+   Returns      -   None
+   Side Effects -   The page is INCORE.
+   ----------------------------------------------------------------------- */
+static void MapPage(int pid, int page, int frame)
+{
+    PTE *pPTE = &FindVmProc(pid)->pageTable[page];
+
+    // Copy-on-write pages stay read-only until the first write.
+    USLOSS_MmuMap(VmTag(pid), page, frame,
+                  pPTE->cow ? USLOSS_MMU_PROT_READ : USLOSS_MMU_PROT_RW);
+    pPTE->state = INCORE;
+    pPTE->frame = frame;
+} /* MapPage */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   CopyOnWrite
+   Purpose      -   Gives a process a private, writable copy of a
+                    copy-on-write page it tried to write.
+   Parameters   -   pid - The process.
+                    page - The page.
+   Returns      -   Zero, or -1 if the page isn't copy-on-write.
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static int CopyOnWrite(int pid, int page)
+{
+    PTE *pPTE = &FindVmProc(pid)->pageTable[page];
+    int frame;
+    int old = pPTE->frame;
+
+    // Evicted since the fault; the retried write will fault it back in.
+    if (pPTE->state != INCORE)
+    {
+        return pPTE->cow ? 0 : -1;
+    }
+
+    if (! pPTE->cow)
+    {
+        return -1;
+    }
+
+    pPTE->cow = 0;
+
+    // The last user of the frame can simply take it over.
+    if (frameTable[old].refs == 1)
+    {
+        if (pPTE->block != -1 && blockRefs[pPTE->block] > 1)
+        {
+            SwapFree(pPTE->block);
+            pPTE->block = -1;
+        }
+
+        USLOSS_MmuProtectRange(VmTag(pid), page, 1, USLOSS_MMU_PROT_RW);
+        return 0;
+    }
+
+    // Copy before looking for a frame, which may evict the original.
+    USLOSS_MmuReadFrame(old, copyBuffer);
+    frame = GetFrame(0);
+
+    if (pPTE->state == INCORE)
+    {
+        USLOSS_MmuUnmap(VmTag(pid), page);
+        ReleaseFrame(old, pid);
+    }
+
+    if (pPTE->block != -1)
+    {
+        SwapFree(pPTE->block);
+        pPTE->block = -1;
+    }
+
+    USLOSS_MmuWriteFrame(frame, copyBuffer);
+    USLOSS_MmuMap(VmTag(pid), page, frame, USLOSS_MMU_PROT_RW);
+    USLOSS_MmuSetAccess(frame, 0);
+    frameTable[frame].pid = pid;
+    frameTable[frame].page = page;
+    frameTable[frame].refs = 1;
+    frameTable[frame].age = LRU_AGE_NEW;
+    frameTable[frame].lastUse = vmStats.faults;
+    pPTE->state = INCORE;
+    pPTE->frame = frame;
+    vmStats.copies++;
+    return 0;
+} /* CopyOnWrite */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ShareRange
+   Purpose      -   Maps pages of the calling process into another process
+                    at the same addresses, either shared or copy-on-write.
+   Parameters   -   pid - The process to share with. It must be alive
+                          and must not have touched the pages yet.
+                    page - First page to share.
+                    count - Number of pages.
+                    cow - Non-zero for copy-on-write.
+   Returns      -   Zero, or -1 for bad arguments.
+   Side Effects -   Pages the caller never touched are zero-filled first.
+   ----------------------------------------------------------------------- */
+static int ShareRange(int pid, int page, int count, int cow)
+{
+    VmProc *pSrc;
+    VmProc *pDst;
+    PTE *pSrcPTE;
+    PTE *pDstPTE;
+    int self = getpid();
+
+    if (vmRegion == NULL || pid < 0 || pid == self || count < 1 ||
+        page < 0 || page + count > vmStats.pages)
+    {
+        return -1;
+    }
+
+    // A process without a tag can't map anything. A pid that no longer
+    // owns its slot would make GetVmProc release the process that does.
+    if (VmTag(pid) == VM_NO_TAG || ! ProcAlive(pid))
+    {
+        return -1;
+    }
+
+    semp_real(vmMutex);
+
+    pSrc = GetVmProc(self);
+    pDst = GetVmProc(pid);
+
+    // A page that is already shared can't switch between shared and
+    // copy-on-write.
+    for (int i = page; i < page + count; i++)
+    {
+        pSrcPTE = &pSrc->pageTable[i];
+
+        if (pDst->pageTable[i].state != UNUSED ||
+            (PageShared(pSrcPTE) && pSrcPTE->cow != cow))
+        {
+            semv_real(vmMutex);
+            return -1;
+        }
+    }
+
+    for (int i = page; i < page + count; i++)
+    {
+        pSrcPTE = &pSrc->pageTable[i];
+        pDstPTE = &pDst->pageTable[i];
+
+        // A page needs a frame or a swap block before it can be shared.
+        if (pSrcPTE->state == UNUSED)
+        {
+            PageIn(self, i);
+        }
+
+        // A private copy-on-write page left over from an earlier VmCow
+        // becomes writable again before it is shared.
+        if (pSrcPTE->cow && ! cow && pSrcPTE->state == INCORE)
+        {
+            USLOSS_MmuProtectRange(VmTag(self), i, 1, USLOSS_MMU_PROT_RW);
+        }
+
+        pSrcPTE->cow = cow;
+        *pDstPTE = *pSrcPTE;
+
+        if (pSrcPTE->block != -1)
+        {
+            blockRefs[pSrcPTE->block]++;
+        }
+
+        if (pSrcPTE->state == INCORE)
+        {
+            frameTable[pSrcPTE->frame].refs++;
+            USLOSS_MmuMap(VmTag(pid), i, pSrcPTE->frame,
+                          pSrcPTE->cow ? USLOSS_MMU_PROT_READ : USLOSS_MMU_PROT_RW);
+
+            if (pSrcPTE->cow)
+            {
+                USLOSS_MmuProtectRange(VmTag(self), i, 1, USLOSS_MMU_PROT_READ);
+            }
+        }
+    }
+
+    semv_real(vmMutex);
+    return 0;
+} /* ShareRange */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   PageShared
+   Purpose      -   Checks whether another process refers to a page's
+                    frame or swap block.
+   Parameters   -   pPTE - The page.
+   Returns      -   Non-zero if the page is shared.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int PageShared(PTE *pPTE)
+{
+    if (pPTE->state == INCORE && frameTable[pPTE->frame].refs > 1)
+    {
+        return 1;
+    }
+
+    return pPTE->block != -1 && blockRefs[pPTE->block] > 1;
+} /* PageShared */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   SharerPTE
+   Purpose      -   Checks whether a process slot maps a frame at a page.
+   Parameters   -   slot - Index into vmProcs.
+                    page - The page.
+                    frame - The frame.
+   Returns      -   The slot's page table entry, or NULL.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static PTE *SharerPTE(int slot, int page, int frame)
+{
+    VmProc *pProc = proc_table_entry(&vmProcs, slot);
+    PTE *pPTE;
+
+    if (pProc->pid == -1)
+    {
+        return NULL;
+    }
+
+    pPTE = &pProc->pageTable[page];
+
+    if (pPTE->state != INCORE || pPTE->frame != frame)
+    {
+        return NULL;
+    }
+
+    return pPTE;
+} /* SharerPTE */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   FindSharedFrame
+   Purpose      -   Looks for a process that has a swap block in memory.
+                    Shared pages always live at the same page number.
+   Parameters   -   page - The page.
+                    block - The swap block.
+   Returns      -   The frame holding the block, or -1.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int FindSharedFrame(int page, int block)
+{
+    VmProc *pProc;
+    PTE *pPTE;
+
+    if (blockRefs[block] < 2)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < numSlots; i++)
+    {
+        pProc = proc_table_entry(&vmProcs, i);
+
+        if (pProc->pid == -1)
+        {
+            continue;
+        }
+
+        pPTE = &pProc->pageTable[page];
+
+        if (pPTE->state == INCORE && pPTE->block == block)
+        {
+            return pPTE->frame;
+        }
+    }
+
+    return -1;
+} /* FindSharedFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   GetFrame
+   Purpose      -   Finds a frame for a faulting page, evicting a page with
+                    the replacement policy if none are free.
+   Parameters   -   zero - The frame must be zero-filled.
+   Returns      -   The frame.
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static int GetFrame(int zero)
+{
+    int frame;
+
+    // Zeroed frames go to new pages; anything else can take an old one.
+    if (zero && zeroFrameList != -1)
+    {
+        frame = zeroFrameList;
+        zeroFrameList = frameTable[frame].next;
+        vmStats.freeFrames--;
+        vmStats.zeroHits++;
+        return frame;
+    }
+
+    frame = PopFreeFrame();
+
+    if (frame == -1)
+    {
+        frame = ChooseVictim();
+        Evict(frame);
+    }
+
+    if (zero)
+    {
+        USLOSS_MmuWriteFrame(frame, zeroPage);
+        vmStats.zeroMisses++;
+    }
+
+    return frame;
+} /* GetFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ChooseVictim
+   Purpose      -   Picks a frame to evict with the replacement policy.
+   Parameters   -   None
+   Returns      -   The frame.
+   Side Effects -   Caller holds vmMutex and found both free lists empty,
+                    so a frame without references is one the zeroer or a
+                    swap read is still filling. The scans skip those.
+   ----------------------------------------------------------------------- */
+static int ChooseVictim(void)
+{
+    switch (vmPolicy)
+    {
+        case VM_ENHANCED_CLOCK:
+            return EnhancedClockVictim();
+
+        case VM_LRU:
+            return LruVictim();
+
+        case VM_WSCLOCK:
+            return WsClockVictim();
+
+        default:
+            return ClockVictim();
+    }
+} /* ChooseVictim */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   PrefetchFrame
+   Purpose      -   Finds a frame for a page read ahead of a fault. If none
+                    are free, the replacement policy picks a victim, which
+                    is evicted if it is a private page of the reader.
+   Parameters   -   pid - The process reading.
+                    held - Frames the read already holds.
+   Returns      -   The frame, or -1 if there is none to take.
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static int PrefetchFrame(int pid, int held)
+{
+    int frame = PopFreeFrame();
+
+    // Keep a referenced frame beyond the read's own and the zeroer's.
+    if (frame != -1 || held + 2 >= vmStats.frames)
+    {
+        return frame;
+    }
+
+    // Pages other processes faulted in may not have been touched yet;
+    // evicting them for a guess could keep those processes from running.
+    frame = ChooseVictim();
+
+    if (frameTable[frame].pid != pid || frameTable[frame].refs > 1)
+    {
+        return -1;
+    }
+
+    Evict(frame);
+    return frame;
+} /* PrefetchFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   PopFreeFrame
+   Purpose      -   Takes a free frame, leaving zeroed ones for last.
+   Parameters   -   None
+   Returns      -   The frame, or -1 if no frame is free.
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static int PopFreeFrame(void)
+{
+    int frame = -1;
+
+    if (freeFrameList != -1)
+    {
+        frame = freeFrameList;
+        freeFrameList = frameTable[frame].next;
+        vmStats.freeFrames--;
+    }
+
+    else if (zeroFrameList != -1)
+    {
+        frame = zeroFrameList;
+        zeroFrameList = frameTable[frame].next;
+        vmStats.freeFrames--;
+    }
+
+    return frame;
+} /* PopFreeFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ClockAdvance
+   Purpose      -   Moves the clock hand to the next frame.
+   Parameters   -   None
+   Returns      -   The frame the hand was on.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int ClockAdvance(void)
+{
+    int frame = clockHand;
+
+    clockHand = (clockHand + 1) % vmStats.frames;
+    return frame;
+} /* ClockAdvance */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ClockVictim
+   Purpose      -   Second chance: skips frames referenced since the hand
+                    last passed them.
+   Parameters   -   None
+   Returns      -   The frame to evict.
+   Side Effects -   Clears reference bits.
+   ----------------------------------------------------------------------- */
+static int ClockVictim(void)
+{
+    int access;
+    int frame;
+
+    for (;;)
+    {
+        frame = ClockAdvance();
+
+        if (frameTable[frame].refs == 0)
+        {
+            continue;
+        }
+
+        USLOSS_MmuGetAccess(frame, &access);
+
+        if ((access & USLOSS_MMU_REF) == 0)
+        {
+            return frame;
+        }
+
+        USLOSS_MmuSetAccess(frame, access & ~USLOSS_MMU_REF);
+    }
+} /* ClockVictim */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   EnhancedClockVictim
+   Purpose      -   Clock that also looks at the dirty bit, preferring
+                    pages that can be dropped without a write to swap.
+   Parameters   -   None
+   Returns      -   The frame to evict.
+   Side Effects -   Clears reference bits.
+   ----------------------------------------------------------------------- */
+static int EnhancedClockVictim(void)
+{
+    int access;
+    int frame;
+
+    for (;;)
+    {
+        // First sweep: an unreferenced, clean frame, touching nothing.
+        for (int i = 0; i < vmStats.frames; i++)
+        {
+            frame = ClockAdvance();
+
+            if (frameTable[frame].refs == 0)
+            {
+                continue;
+            }
+
+            USLOSS_MmuGetAccess(frame, &access);
+
+            if (access == 0)
+            {
+                return frame;
+            }
+        }
+
+        // Second sweep: an unreferenced, dirty frame, clearing reference
+        // bits so the next round is sure to find something.
+        for (int i = 0; i < vmStats.frames; i++)
+        {
+            frame = ClockAdvance();
+
+            if (frameTable[frame].refs == 0)
+            {
+                continue;
+            }
+
+            USLOSS_MmuGetAccess(frame, &access);
+
+            if ((access & USLOSS_MMU_REF) == 0)
+            {
+                return frame;
+            }
+
+            USLOSS_MmuSetAccess(frame, access & ~USLOSS_MMU_REF);
+        }
+    }
+} /* EnhancedClockVictim */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   SampleAccess
+   Purpose      -   Shifts every frame's reference bit into its age, the
+                    sampling half of approximate LRU.
+   Parameters   -   None
+   Returns      -   None
+   Side Effects -   Clears reference bits.
+   ----------------------------------------------------------------------- */
+static void SampleAccess(void)
+{
+    int access;
+
+    for (int frame = 0; frame < vmStats.frames; frame++)
+    {
+        USLOSS_MmuGetAccess(frame, &access);
+        frameTable[frame].age >>= 1;
+
+        if (access & USLOSS_MMU_REF)
+        {
+            frameTable[frame].age |= LRU_AGE_NEW;
+            USLOSS_MmuSetAccess(frame, access & ~USLOSS_MMU_REF);
+        }
+    }
+} /* SampleAccess */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   LruVictim
+   Purpose      -   Approximate LRU: the frame with the smallest age.
+   Parameters   -   None
+   Returns      -   The frame to evict.
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static int LruVictim(void)
+{
+    int victim = -1;
+
+    for (int frame = 0; frame < vmStats.frames; frame++)
+    {
+        if (frameTable[frame].refs != 0 &&
+            (victim == -1 || frameTable[frame].age < frameTable[victim].age))
+        {
+            victim = frame;
+        }
+    }
+
+    return victim;
+} /* LruVictim */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   WsClockVictim
+   Purpose      -   WSClock: evicts a clean page that has fallen out of its
+                    process's working set, cleaning dirty ones on the way.
+                    Time is counted in faults.
+   Parameters   -   None
+   Returns      -   The frame to evict.
+   Side Effects -   Clears reference bits and may write pages to swap.
+   ----------------------------------------------------------------------- */
+static int WsClockVictim(void)
+{
+    int access;
+    int frame;
+    int oldest = -1;
+
+    // Two turns: the first may only clean pages the second can take.
+    for (int i = 0; i < 2 * vmStats.frames; i++)
+    {
+        frame = ClockAdvance();
+
+        if (frameTable[frame].refs == 0)
+        {
+            continue;
+        }
+
+        USLOSS_MmuGetAccess(frame, &access);
+
+        if (access & USLOSS_MMU_REF)
+        {
+            USLOSS_MmuSetAccess(frame, access & ~USLOSS_MMU_REF);
+            frameTable[frame].lastUse = vmStats.faults;
+        }
+
+        else if (vmStats.faults - frameTable[frame].lastUse <= WS_WINDOW)
+        {
+            if (oldest == -1 || frameTable[frame].lastUse < frameTable[oldest].lastUse)
+            {
+                oldest = frame;
+            }
+        }
+
+        else if (access & USLOSS_MMU_DIRTY)
+        {
+            PageOut(frame, 1);
+        }
+
+        else
+        {
+            return frame;
+        }
+    }
+
+    // Every page is in a working set; take the least recently used one.
+    return oldest != -1 ? oldest : ClockVictim();
+} /* WsClockVictim */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   Evict
+   Purpose      -   Removes the page in a frame from every process that
+                    maps it, writing it to swap if the swap copy is missing
+                    or stale.
+   Parameters   -   frame - The frame to empty.
+   Returns      -   None
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static void Evict(int frame)
+{
+    PTE *pPTE;
+    int access;
+    int page = frameTable[frame].page;
+
+    pPTE = &FindVmProc(frameTable[frame].pid)->pageTable[page];
+
+    // Unmap first so no sharer can write behind our back.
+    for (int i = 0; i < numSlots; i++)
+    {
+        if (SharerPTE(i, page, frame) != NULL)
+        {
+            USLOSS_MmuUnmap(i, page);
+        }
+    }
+
+    USLOSS_MmuGetAccess(frame, &access);
+
+    if ((access & USLOSS_MMU_DIRTY) || pPTE->block == -1)
+    {
+        PageOut(frame, 1);
+    }
+
+    for (int i = 0; i < numSlots; i++)
+    {
+        if ((pPTE = SharerPTE(i, page, frame)) != NULL)
+        {
+            pPTE->state = ONDISK;
+            pPTE->frame = -1;
+        }
+    }
+
+    frameTable[frame].pid = -1;
+    frameTable[frame].page = -1;
+    frameTable[frame].refs = 0;
+    vmStats.replaced++;
+} /* Evict */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   PageOut
+   Purpose      -   Writes the page in a frame to its swap block, giving it
+                    a block if it has none. When clustering, dirty
+                    neighbours in the same extent go out in the same disk
+                    request.
+   Parameters   -   frame - The frame to write.
+                    cluster - Write dirty neighbours too.
+   Returns      -   None
+   Side Effects -   Clears the dirty bits of the frames written. Caller
+                    holds vmMutex.
+   ----------------------------------------------------------------------- */
+static void PageOut(int frame, int cluster)
+{
+    VmProc *pProc;
+    PTE *pPTE;
+    PTE *pSharer;
+    int access;
+    int page = frameTable[frame].page;
+    int group = page - page % SWAP_CLUSTER;
+    int first = page;
+    int last = page;
+
+    pProc = FindVmProc(frameTable[frame].pid);
+    pPTE = &pProc->pageTable[page];
+
+    // Everyone sharing the frame shares its swap block too.
+    if (pPTE->block == -1)
+    {
+        pPTE->block = SwapAlloc(pProc->pid, page);
+
+        for (int i = 0; i < numSlots; i++)
+        {
+            pSharer = SharerPTE(i, page, frame);
+
+            if (pSharer != NULL && pSharer != pPTE)
+            {
+                pSharer->block = pPTE->block;
+                blockRefs[pPTE->block]++;
+            }
+        }
+    }
+
+    // Neighbours only line up on disk when the page sits in its own
+    // extent.
+    if (cluster && pProc->extents[page / SWAP_CLUSTER] * SWAP_CLUSTER +
+        page % SWAP_CLUSTER == pPTE->block)
+    {
+        while (first > group && ClusterPage(pProc, first - 1, pPTE->block - (page - first + 1)))
+        {
+            first--;
+        }
+
+        while (last + 1 < group + SWAP_CLUSTER &&
+               ClusterPage(pProc, last + 1, pPTE->block + last + 1 - page))
+        {
+            last++;
+        }
+    }
+
+    // Clear each dirty bit before copying so a write during the disk I/O
+    // marks the page dirty again.
+    for (int i = first; i <= last; i++)
+    {
+        frame = pProc->pageTable[i].frame;
+        USLOSS_MmuGetAccess(frame, &access);
+        USLOSS_MmuSetAccess(frame, access & ~USLOSS_MMU_DIRTY);
+        USLOSS_MmuReadFrame(frame, pageBuffer + (i - first) * pageSize);
+    }
+
+    SwapIO(DISK_WRITE, pPTE->block - (page - first), last - first + 1, pageBuffer);
+    vmStats.pageOuts += last - first + 1;
+} /* PageOut */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ClusterPage
+   Purpose      -   Checks whether a neighbour can join a clustered write
+                    that would put it at a given block, claiming the block
+                    if the page has none yet.
+   Parameters   -   pProc - The process.
+                    page - The neighbour.
+                    block - Block the run would write it to.
+   Returns      -   1 if the page is a private, resident page that needs
+                    writing to that block.
+   Side Effects -   Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static int ClusterPage(VmProc *pProc, int page, int block)
+{
+    PTE *pPTE;
+    int access;
+
+    if (page >= pProc->numPages)
+    {
+        return 0;
+    }
+
+    pPTE = &pProc->pageTable[page];
+
+    if (pPTE->state != INCORE || frameTable[pPTE->frame].refs != 1)
+    {
+        return 0;
+    }
+
+    // Never written out, and its slot in the extent is still free.
+    if (pPTE->block == -1 && blockRefs[block] == 0)
+    {
+        pPTE->block = block;
+        blockRefs[block] = 1;
+        vmStats.freeBlocks--;
+        return 1;
+    }
+
+    USLOSS_MmuGetAccess(pPTE->frame, &access);
+    return pPTE->block == block && (access & USLOSS_MMU_DIRTY);
+} /* PageOut */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   FreeFrame
+   Purpose      -   Puts a frame back on the free list.
+   Parameters   -   frame - The frame.
+   Returns      -   None
+   Side Effects -   Wakes the zeroer. Caller holds vmMutex.
+   ----------------------------------------------------------------------- */
+static void FreeFrame(int frame)
+{
+    frameTable[frame].pid = -1;
+    frameTable[frame].page = -1;
+    frameTable[frame].refs = 0;
+    frameTable[frame].next = freeFrameList;
+    freeFrameList = frame;
+    vmStats.freeFrames++;
+    semv_real(zeroerSem);
+} /* FreeFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ReleaseFrame
+   Purpose      -   Drops a process's reference to a frame, freeing the
+                    frame with the last reference.
+   Parameters   -   frame - The frame.
+                    pid - The process letting go of it.
+   Returns      -   None
+   Side Effects -   Caller holds vmMutex and has unmapped the page.
+   ----------------------------------------------------------------------- */
+static void ReleaseFrame(int frame, int pid)
+{
+    VmProc *pProc;
+    int page = frameTable[frame].page;
+
+    if (--frameTable[frame].refs == 0)
+    {
+        FreeFrame(frame);
+        return;
+    }
+
+    // Hand the frame to another sharer.
+    if (frameTable[frame].pid == pid)
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            pProc = proc_table_entry(&vmProcs, i);
+
+            if (pProc->pid != pid && SharerPTE(i, page, frame) != NULL)
+            {
+                frameTable[frame].pid = pProc->pid;
+                break;
+            }
+        }
+    }
+} /* ReleaseFrame */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   SwapAlloc
+   Purpose      -   Allocates a swap block with one reference. Each group
+                    of SWAP_CLUSTER pages of a process gets an extent of
+                    as many consecutive blocks, so neighbouring pages can
+                    move in one disk request.
+   Parameters   -   pid - The process the page belongs to.
+                    page - The page.
+   Returns      -   The block.
+   Side Effects -   Halts if the swap area is full.
+   ----------------------------------------------------------------------- */
+static int SwapAlloc(int pid, int page)
+{
+    VmProc *pProc = FindVmProc(pid);
+    int group = page / SWAP_CLUSTER;
+    int block;
+
+    if (pProc->extents[group] == -1)
+    {
+        pProc->extents[group] = ExtentAlloc(pid);
+    }
+
+    if (pProc->extents[group] != -1)
+    {
+        block = pProc->extents[group] * SWAP_CLUSTER + page % SWAP_CLUSTER;
+
+        if (blockRefs[block] == 0)
+        {
+            blockRefs[block] = 1;
+            vmStats.freeBlocks--;
+            return block;
+        }
+    }
+
+    // No extent to be had: take any free block, raiding other processes'
+    // extents only as a last resort.
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (block = 0; block < vmStats.blocks; block++)
+        {
+            if (blockRefs[block] == 0 &&
+                (pass == 1 || block / SWAP_CLUSTER >= numExtents ||
+                 extentOwner[block / SWAP_CLUSTER] == -1))
+            {
+                blockRefs[block] = 1;
+                vmStats.freeBlocks--;
+                return block;
+            }
+        }
+    }
+
+    console("SwapAlloc(): Swap disk is full! Halting...\n");
+    halt(1);
+    return -1;
+} /* SwapAlloc */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   ExtentAlloc
+   Purpose      -   Reserves a swap extent whose blocks are all free.
+   Parameters   -   pid - The process to reserve it for.
+   Returns      -   The extent, or -1 if there is none.
+   Side Effects -   Blocks of an extent are still allocated one at a time.
+   ----------------------------------------------------------------------- */
+static int ExtentAlloc(int pid)
+{
+    int block;
+
+    for (int extent = 0; extent < numExtents; extent++)
+    {
+        if (extentOwner[extent] != -1)
+        {
+            continue;
+        }
+
+        for (block = extent * SWAP_CLUSTER; block < (extent + 1) * SWAP_CLUSTER; block++)
+        {
+            if (blockRefs[block] != 0)
+            {
+                break;
+            }
+        }
+
+        if (block == (extent + 1) * SWAP_CLUSTER)
+        {
+            extentOwner[extent] = pid;
+            return extent;
+        }
+    }
+
+    return -1;
+} /* ExtentAlloc */
+
+
+
+/* ------------------------------------------------------------------------
+   Name         -   SwapFree
+   Purpose      -   Drops a reference to a swap block, freeing the block
+                    with the last reference.
+   Parameters   -   block - The block.
+   Returns      -   None
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void SwapFree(int block)
+{
+    if (--blockRefs[block] == 0)
+    {
+        vmStats.freeBlocks++;
+    }
+} /* SwapFree */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   SwapIO
+   Purpose      -   Reads or writes a run of consecutive swap blocks with
+                    one request to the disk driver.
+   Parameters   -   io - DISK_READ or DISK_WRITE.
+                    block - The first swap block.
+                    count - Number of blocks.
+                    buffer - count pages of memory.
+   Returns      -   Zero
+   Side Effects -   Halts if the disk reports an error.
+   ----------------------------------------------------------------------- */
+static int SwapIO(int io, int block, int count, void *buffer)
+{
+    int result;
+    int sector = block * sectorsPerPage;
+    int track = sector / sectorsPerTrack;
+    int first = sector % sectorsPerTrack;
+
+    // The driver carries the transfer across track boundaries.
+    if (io == DISK_READ)
+    {
+        result = disk_read_real(SWAP_DISK, track, first, count * sectorsPerPage, buffer);
+        vmStats.swapReads++;
+    }
+
+    else
+    {
+        result = disk_write_real(SWAP_DISK, track, first, count * sectorsPerPage, buffer);
+        vmStats.swapWrites++;
+    }
+
+    if (result != 0)
+    {
+        console("SwapIO(): Disk error %d on block %d! Halting...\n", result, block);
+        halt(1);
+    }
+
+    return 0;
+} /* SwapIO */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   PrintStats
+   Purpose      -   Prints the paging statistics.
+   Parameters   -   None
+   Returns      -   None
+   Side Effects -
+   ----------------------------------------------------------------------- */
+static void PrintStats(void)
+{
+    console("VmStats\n");
+    console("pages:          %d\n", vmStats.pages);
+    console("frames:         %d\n", vmStats.frames);
+    console("blocks:         %d\n", vmStats.blocks);
+    console("freeFrames:     %d\n", vmStats.freeFrames);
+    console("usedFrames:     %d (peak %d)\n", vmStats.frames - vmStats.freeFrames,
+            vmStats.peakFrames);
+    console("freeBlocks:     %d\n", vmStats.freeBlocks);
+    console("usedBlocks:     %d (peak %d)\n", vmStats.blocks - vmStats.freeBlocks,
+            vmStats.peakBlocks);
+    console("switches:       %d\n", vmStats.switches);
+    console("faults:         %d\n", vmStats.faults);
+    console("new:            %d\n", vmStats.newPages);
+
+    if (vmStats.newPages > 0)
+    {
+        console("zeroHits:       %d (%d%% of new pages)\n", vmStats.zeroHits,
+                100 * vmStats.zeroHits / vmStats.newPages);
+    }
+
+    console("zeroMisses:     %d\n", vmStats.zeroMisses);
+    console("zeroed:         %d\n", vmStats.zeroed);
+    console("pageIns:        %d\n", vmStats.pageIns);
+    console("pageOuts:       %d\n", vmStats.pageOuts);
+    console("prefetched:     %d\n", vmStats.prefetched);
+    console("swapReads:      %d\n", vmStats.swapReads);
+    console("swapWrites:     %d\n", vmStats.swapWrites);
+    console("replaced:       %d\n", vmStats.replaced);
+    console("copies:         %d\n", vmStats.copies);
+    console("heapCalls:      %d\n", vmStats.heapCalls);
+
+    if (vmStats.faults > 0)
+    {
+        console("faultTime:      %d us (%d us per fault)\n", vmStats.faultTime,
+                vmStats.faultTime / vmStats.faults);
+    }
+
+    // Processes in the order they quit.
+    console("process  faults  resident  swapped\n");
+
+    for (int i = 0; i < procLogCount && i < MAXPROC; i++)
+    {
+        console("%7d  %6d  %8d  %7d\n", procLog[i].pid, procLog[i].faults,
+                procLog[i].resident, procLog[i].swapped);
+    }
+
+    if (procLogCount > MAXPROC)
+    {
+        console("(%d more processes not shown)\n", procLogCount - MAXPROC);
+    }
+} /* PrintStats */
+
+
+/* ------------------------------------------------------------------------
+   Name         -   check_kernel_mode
+   Purpose      -   To check if a process is in kernel mode or not.
+   Parameters   -   procName - The name of the process to check.
+   Returns      -   None
+   Side Effects -   Halts if not in kernel mode.
+   ----------------------------------------------------------------------- */
+static void check_kernel_mode(char *procName)
+{
+    // Check if not in kernel mode.
+    if ((PSR_CURRENT_MODE & psr_get()) == 0)
+    {
+        console("%s(): Not in Kernel Mode! Halting...\n", procName);
+        halt(1);
+    }
+} /* check_kernel_mode */
@@ -0,0 +1,101 @@
+/*
+ * These are the definitions for phase 5 of the project (virtual memory).
+ */
+
+#ifndef _PHASE5_H
+#define _PHASE5_H
+
+/*
+ * Tunables.
+ */
+
+#define MAXPAGERS       4       // Most pager processes VmInit will create.
+#define PAGER_PRIORITY  2       // Pagers run above every user process.
+#define ZEROER_PRIORITY 5       // The frame zeroer runs only when user
+                                // processes are blocked.
+#define SWAP_DISK       1       // Disk unit that holds the swap area.
+#define SWAP_CLUSTER    4       // Pages in a swap extent, and the most
+                                // moved by one clustered read or write.
+#define WS_WINDOW       16      // WSClock working set window (in faults).
+#define HEAP_RESERVED   1       // Pages at the top of the region kept for
+                                // the user allocator's state.
+
+/*
+ * Page replacement policies, selected with VmInitPolicy.
+ */
+
+#define VM_CLOCK            0   // Second chance.
+#define VM_ENHANCED_CLOCK   1   // Second chance, preferring clean pages.
+#define VM_LRU              2   // Approximate LRU by sampling access bits.
+#define VM_WSCLOCK          3   // Working set clock.
+
+/*
+ * Error codes returned by vm_init_real.
+ */
+
+#define VM_ERR_INVALID  -1      // Bad mappings, pages, frames, pagers or policy.
+#define VM_ERR_ACTIVE   -2      // VmInit was already called.
+
+/*
+ * Paging statistics, printed by VmCleanup. faultTime is the total
+ * simulated time, in microseconds, that processes spent blocked on
+ * page faults.
+ */
+
+typedef struct VmStats
+{
+    int pages;          // Size of the VM region (in pages).
+    int frames;         // Size of physical memory (in frames).
+    int blocks;         // Size of the swap area (in pages).
+    int freeFrames;     // Number of frames not in use.
+    int freeBlocks;     // Number of swap blocks not in use.
+    int peakFrames;     // Most frames in use at once.
+    int peakBlocks;     // Most swap blocks in use at once.
+    int switches;       // Number of context switches.
+    int faults;         // Number of page faults.
+    int newPages;       // Faults that zero-filled a page never seen before.
+    int zeroHits;       // New pages given a frame the zeroer had cleared.
+    int zeroMisses;     // New pages that had to be zeroed in the fault.
+    int zeroed;         // Frames cleared by the zeroer.
+    int pageIns;        // Faults that read a page back from swap.
+    int pageOuts;       // Pages written out to swap.
+    int prefetched;     // Pages read in alongside a faulting neighbour.
+    int swapReads;      // Disk requests that read from swap.
+    int swapWrites;     // Disk requests that wrote to swap.
+    int replaced;       // Pages evicted from a frame to make room.
+    int copies;         // Copy-on-write pages copied on a write.
+    int heapCalls;      // HeapAlloc and HeapFree system calls.
+    int faultTime;      // Time spent servicing faults.
+} VmStats;
+
+/*
+ * Paging statistics of one process. For a process that has quit,
+ * resident and swapped are its footprint when it quit.
+ */
+
+typedef struct VmProcStats
+{
+    int pid;            // The process.
+    int faults;         // Page faults it took.
+    int resident;       // Pages in a frame.
+    int swapped;        // Pages only in the swap area.
+} VmProcStats;
+
+extern VmStats  vmStats;
+extern void     *vmRegion;
+
+/*
+ * Function prototypes for this phase.
+ */
+
+extern  void    *vm_init_real(int mappings, int pages, int frames, int pagers,
+                              int policy);
+extern  void    vm_cleanup_real(void);
+extern  void    *heap_alloc_real(int pages);
+extern  int     heap_free_real(void *addr, int pages);
+extern  int     vm_stats_real(VmStats *pStats);
+extern  int     vm_proc_stats_real(int pid, VmProcStats *pProcStats);
+
+extern  int     start5(char *arg);
+
+#endif /* _PHASE5_H */
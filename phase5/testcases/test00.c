@@ -0,0 +1,43 @@
+/*
+ * test00.c
+ *
+ * One process touches every page of a VM region that fits in memory.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+
+#define PAGES 8
+
+int start5(char *arg)
+{
+  char *region;
+  int page;
+  int pageSize;
+
+  printf("start5(): Touch %d pages with %d frames.\n", PAGES, PAGES);
+
+  region = VmInit(PAGES, PAGES, PAGES, 2);
+  assert(region != NULL);
+  pageSize = USLOSS_MmuPageSize();
+
+  for (page = 0; page < PAGES; page++) {
+    assert(region[page * pageSize] == 0);
+    region[page * pageSize] = 'A' + page;
+  }
+  for (page = 0; page < PAGES; page++) {
+    assert(region[page * pageSize] == 'A' + page);
+  }
+
+  printf("start5(): All %d pages read back correctly.\n", PAGES);
+  VmCleanup();
+  Terminate(0);
+
+  return 0;
+} /* start5 */
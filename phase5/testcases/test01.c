@@ -0,0 +1,48 @@
+/*
+ * test01.c
+ *
+ * One process writes a region four times the size of physical memory,
+ * so every page goes out to swap and comes back in.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+
+#define PAGES  16
+#define FRAMES 4
+
+int start5(char *arg)
+{
+  char *region;
+  int page;
+  int pageSize;
+  int pass;
+
+  printf("start5(): Write %d pages with %d frames.\n", PAGES, FRAMES);
+
+  region = VmInit(PAGES, PAGES, FRAMES, 2);
+  assert(region != NULL);
+  pageSize = USLOSS_MmuPageSize();
+
+  for (page = 0; page < PAGES; page++) {
+    memset(&region[page * pageSize], 'a' + page, pageSize);
+  }
+  for (pass = 0; pass < 2; pass++) {
+    for (page = 0; page < PAGES; page++) {
+      assert(region[page * pageSize] == 'a' + page);
+      assert(region[page * pageSize + pageSize - 1] == 'a' + page);
+    }
+  }
+
+  printf("start5(): All %d pages survived swapping.\n", PAGES);
+  VmCleanup();
+  Terminate(0);
+
+  return 0;
+} /* start5 */
@@ -0,0 +1,69 @@
+/*
+ * test02.c
+ *
+ * Three children write the same pages of the VM region and check that
+ * each one sees only its own data.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <assert.h>
+
+#define CHILDREN 3
+#define PAGES    8
+#define FRAMES   6
+
+static char *region;
+
+int Child(char *arg)
+{
+  int me = atoi(arg);
+  int page;
+  int pageSize = USLOSS_MmuPageSize();
+
+  for (page = 0; page < PAGES; page++) {
+    region[page * pageSize] = me * PAGES + page;
+  }
+  for (page = 0; page < PAGES; page++) {
+    assert(region[page * pageSize] == me * PAGES + page);
+  }
+
+  printf("Child%d(): Private pages ok.\n", me);
+  Terminate(me);
+
+  return 0;
+} /* Child */
+
+
+int start5(char *arg)
+{
+  char name[16];
+  char buf[16];
+  int pid, status;
+  int i;
+
+  printf("start5(): %d children share %d frames.\n", CHILDREN, FRAMES);
+
+  region = VmInit(PAGES, PAGES, FRAMES, 2);
+  assert(region != NULL);
+
+  for (i = 0; i < CHILDREN; i++) {
+    sprintf(name, "Child%d", i);
+    sprintf(buf, "%d", i);
+    Spawn(name, Child, buf, USLOSS_MIN_STACK, 4, &pid);
+  }
+  for (i = 0; i < CHILDREN; i++) {
+    Wait(&pid, &status);
+  }
+
+  printf("start5(): Done.\n");
+  VmCleanup();
+  Terminate(0);
+
+  return 0;
+} /* start5 */
@@ -0,0 +1,92 @@
+/*
+ * test03.c
+ *
+ * Replacement policy benchmark. Replays synthetic reference strings
+ * (a loop slightly larger than memory, uniform random references, and
+ * working sets that shift between phases) under every policy and
+ * reports the fault rate and page-outs of each.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <phase5.h>
+#include <assert.h>
+
+#define PAGES      32
+#define FRAMES     8
+#define REFS       1000
+#define WORKINGSET 6     /* pages in each phase of the phased string */
+#define PHASES     4
+
+#define LOOPING    0
+#define RANDOM     1
+#define PHASED     2
+
+static char *patternNames[] = { "looping", "random", "phased" };
+static char *policyNames[] = { "clock", "enhanced clock", "approx LRU",
+                               "WSClock" };
+static unsigned int seed;
+
+static int Rand(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+} /* Rand */
+
+
+static int NextPage(int pattern, int ref)
+{
+  switch (pattern) {
+  case LOOPING:
+    return ref % (FRAMES + 2);
+  case RANDOM:
+    return Rand() % PAGES;
+  default:
+    return (ref / (REFS / PHASES)) * WORKINGSET + Rand() % WORKINGSET;
+  }
+} /* NextPage */
+
+
+int start5(char *arg)
+{
+  char *region;
+  int pageSize;
+  int pattern, policy, ref, page;
+
+  printf("start5(): %d references over %d pages with %d frames.\n",
+         REFS, PAGES, FRAMES);
+  printf("%-10s %-15s %8s %10s %9s\n", "pattern", "policy", "faults",
+         "fault rate", "pageOuts");
+
+  for (pattern = LOOPING; pattern <= PHASED; pattern++) {
+    for (policy = VM_CLOCK; policy <= VM_WSCLOCK; policy++) {
+      region = VmInitPolicy(PAGES, PAGES, FRAMES, 1, policy);
+      assert(region != NULL);
+      pageSize = USLOSS_MmuPageSize();
+
+      /* Same string for every policy; one reference in three writes. */
+      seed = 452 + pattern;
+      for (ref = 0; ref < REFS; ref++) {
+        page = NextPage(pattern, ref);
+        if (Rand() % 3 == 0)
+          region[page * pageSize] = ref;
+        else
+          (void) *(volatile char *) &region[page * pageSize];
+      }
+
+      VmCleanup();
+      printf("%-10s %-15s %8d %9.1f%% %9d\n", patternNames[pattern],
+             policyNames[policy], vmStats.faults,
+             100.0 * vmStats.faults / REFS, vmStats.pageOuts);
+    }
+  }
+
+  Terminate(0);
+
+  return 0;
+} /* start5 */
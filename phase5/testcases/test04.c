@@ -0,0 +1,92 @@
+/*
+ * test04.c
+ *
+ * start5 fills the VM region and gives copy-on-write copies of it to
+ * several children. Each child checks the image, writes one page of its
+ * own and checks again, so only the written pages should cost frames.
+ * The last page is shared outright and collects a mark from every child.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <phase5.h>
+#include <assert.h>
+
+#define CHILDREN 4
+#define PAGES    8
+#define FRAMES   8
+#define SHARED   (PAGES - 1)
+
+static char *region;
+static int pageSize;
+
+int Child(char *arg)
+{
+  int me = atoi(arg);
+  int page;
+
+  for (page = 0; page < SHARED; page++) {
+    assert(region[page * pageSize] == 'A' + page);
+  }
+  region[me * pageSize] = 'a' + me;
+  for (page = 0; page < SHARED; page++) {
+    assert(region[page * pageSize] == (page == me ? 'a' + me : 'A' + page));
+  }
+  region[SHARED * pageSize + me] = 'a' + me;
+
+  printf("Child%d(): Copy-on-write pages ok.\n", me);
+  Terminate(me);
+
+  return 0;
+} /* Child */
+
+
+int start5(char *arg)
+{
+  char name[16];
+  char buf[16];
+  int pid, status;
+  int i;
+
+  printf("start5(): %d children copy %d pages with %d frames.\n",
+         CHILDREN, PAGES, FRAMES);
+
+  region = VmInit(PAGES, PAGES, FRAMES, 2);
+  assert(region != NULL);
+  pageSize = USLOSS_MmuPageSize();
+
+  for (i = 0; i < SHARED; i++) {
+    region[i * pageSize] = 'A' + i;
+  }
+
+  /* Children run at a lower priority, so they can't touch the region
+   * before start5 shares it. */
+  for (i = 0; i < CHILDREN; i++) {
+    sprintf(name, "Child%d", i);
+    sprintf(buf, "%d", i);
+    Spawn(name, Child, buf, USLOSS_MIN_STACK, 4, &pid);
+    assert(VmCow(pid, 0, SHARED) == 0);
+    assert(VmShare(pid, SHARED, 1) == 0);
+  }
+  for (i = 0; i < CHILDREN; i++) {
+    Wait(&pid, &status);
+  }
+
+  for (i = 0; i < SHARED; i++) {
+    assert(region[i * pageSize] == 'A' + i);
+  }
+  for (i = 0; i < CHILDREN; i++) {
+    assert(region[SHARED * pageSize + i] == 'a' + i);
+  }
+
+  printf("start5(): Parent image intact, %d pages copied.\n", vmStats.copies);
+  VmCleanup();
+  Terminate(0);
+
+  return 0;
+} /* start5 */
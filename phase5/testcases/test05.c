@@ -0,0 +1,86 @@
+/*
+ * test05.c
+ *
+ * Two children allocate, fill, free and reallocate blocks of many sizes
+ * from their private heaps, then check every surviving block. start5
+ * reports how many allocations needed a system call.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <phase5.h>
+#include <assert.h>
+
+#define CHILDREN 2
+#define BLOCKS   50      /* both heaps fit in the 64-block swap disk */
+#define ROUNDS   5
+#define PAGES    64
+#define FRAMES   16
+
+static int sizes[] = { 8, 16, 24, 100, 500, 1000, 2000, 5000 };
+#define NUM_SIZES ((int) (sizeof(sizes) / sizeof(sizes[0])))
+
+int Child(char *arg)
+{
+  char *blocks[BLOCKS];
+  int me = atoi(arg);
+  int round, i, size;
+
+  memset(blocks, 0, sizeof(blocks));
+  for (round = 0; round < ROUNDS; round++) {
+    for (i = 0; i < BLOCKS; i++) {
+      if (blocks[i] != NULL && (i + round) % 2 == 0) {
+        Free(blocks[i]);
+        blocks[i] = NULL;
+      }
+      if (blocks[i] == NULL) {
+        size = sizes[(i + round) % NUM_SIZES];
+        blocks[i] = Malloc(size);
+        assert(blocks[i] != NULL);
+        memset(blocks[i], me * BLOCKS + i, size);
+      }
+    }
+  }
+  for (i = 0; i < BLOCKS; i++) {
+    assert(blocks[i][0] == (char) (me * BLOCKS + i));
+    Free(blocks[i]);
+  }
+
+  printf("Child%d(): Heap blocks ok.\n", me);
+  Terminate(me);
+
+  return 0;
+} /* Child */
+
+
+int start5(char *arg)
+{
+  char name[16];
+  char buf[16];
+  int pid, status;
+  int i;
+
+  printf("start5(): %d children allocate from private heaps.\n", CHILDREN);
+
+  assert(VmInit(PAGES, PAGES, FRAMES, 2) != NULL);
+
+  for (i = 0; i < CHILDREN; i++) {
+    sprintf(name, "Child%d", i);
+    sprintf(buf, "%d", i);
+    Spawn(name, Child, buf, USLOSS_MIN_STACK, 4, &pid);
+  }
+  for (i = 0; i < CHILDREN; i++) {
+    Wait(&pid, &status);
+  }
+
+  printf("start5(): %d heap system calls.\n", vmStats.heapCalls);
+  VmCleanup();
+  Terminate(0);
+
+  return 0;
+} /* start5 */
@@ -0,0 +1,76 @@
+/*
+ * test06.c
+ *
+ * Children run one after another, each dirtying every page and then
+ * quitting. start5 sleeps between them so the zeroer can clear the freed
+ * frames, and the next child's new pages should be served from the pool
+ * of zeroed frames. Every child checks that its new pages read as zero.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <phase5.h>
+#include <assert.h>
+
+#define CHILDREN 4
+#define PAGES    8
+#define FRAMES   8
+
+static char *region;
+
+int Child(char *arg)
+{
+  int me = atoi(arg);
+  int page, i;
+  int pageSize = USLOSS_MmuPageSize();
+
+  for (page = 0; page < PAGES; page++) {
+    for (i = 0; i < pageSize; i++) {
+      assert(region[page * pageSize + i] == 0);
+    }
+    memset(&region[page * pageSize], me + 1, pageSize);
+  }
+
+  printf("Child%d(): New pages were zero.\n", me);
+  Terminate(me);
+
+  return 0;
+} /* Child */
+
+
+int start5(char *arg)
+{
+  char name[16];
+  char buf[16];
+  int pid, status;
+  int i;
+
+  printf("start5(): %d children, one at a time.\n", CHILDREN);
+
+  region = VmInit(PAGES, PAGES, FRAMES, 1);
+  assert(region != NULL);
+
+  for (i = 0; i < CHILDREN; i++) {
+    Sleep(1);
+    sprintf(name, "Child%d", i);
+    sprintf(buf, "%d", i);
+    Spawn(name, Child, buf, USLOSS_MIN_STACK, 4, &pid);
+    Wait(&pid, &status);
+  }
+
+  VmCleanup();
+  printf("start5(): %d of %d new pages came from the zeroed pool.\n",
+         vmStats.zeroHits, vmStats.newPages);
+
+  /* Each child's Terminate frees its frames before start5 sleeps, so every
+   * child after the first finds a full pool. */
+  assert(vmStats.zeroHits >= (CHILDREN - 1) * PAGES);
+  Terminate(0);
+
+  return 0;
+} /* start5 */
@@ -0,0 +1,56 @@
+/*
+ * test07.c
+ *
+ * Sweeps sequentially over twice as many pages as there are frames, so
+ * every pass pushes the whole region through swap. Checks the contents
+ * and compares the pages moved with the disk requests it took.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <phase5.h>
+#include <assert.h>
+
+#define PAGES    32
+#define FRAMES   16
+#define PASSES   4
+
+int start5(char *arg)
+{
+  char *region;
+  int pageSize;
+  int pass, page;
+
+  printf("start5(): %d sequential passes over %d pages with %d frames.\n",
+         PASSES, PAGES, FRAMES);
+
+  region = VmInit(PAGES, PAGES, FRAMES, 1);
+  assert(region != NULL);
+  pageSize = USLOSS_MmuPageSize();
+
+  for (pass = 0; pass < PASSES; pass++) {
+    for (page = 0; page < PAGES; page++) {
+      if (pass > 0) {
+        assert(region[page * pageSize] == (char) (page + pass - 1));
+      }
+      region[page * pageSize] = page + pass;
+    }
+  }
+
+  VmCleanup();
+  printf("start5(): %d pages written in %d requests, %d read in %d.\n",
+         vmStats.pageOuts, vmStats.swapWrites,
+         vmStats.pageIns + vmStats.prefetched, vmStats.swapReads);
+
+  /* Memory is always full here, so any clustering on the read side comes
+   * from read-ahead that evicts to make room. */
+  assert(vmStats.swapReads < vmStats.pageIns + vmStats.prefetched);
+  Terminate(0);
+
+  return 0;
+} /* start5 */
@@ -0,0 +1,78 @@
+/*
+ * test08.c
+ *
+ * Children touch different numbers of pages and read their own paging
+ * statistics; start5 reads the totals while the VM system is running.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <usyscall.h>
+#include <libuser.h>
+#include <phase5.h>
+#include <assert.h>
+
+#define CHILDREN 3
+#define PAGES    8
+#define FRAMES   4
+
+static char *region;
+
+int Child(char *arg)
+{
+  VmProcStats procStats;
+  int me = atoi(arg);
+  int pageSize = USLOSS_MmuPageSize();
+  int pid, page;
+
+  for (page = 0; page < 2 * (me + 1); page++) {
+    region[page * pageSize] = me;
+  }
+
+  GetPID(&pid);
+  assert(VmGetProcStats(pid, &procStats) == 0);
+  assert(procStats.pid == pid);
+  assert(procStats.faults >= 2 * (me + 1));
+  printf("Child%d(): %d faults, %d resident, %d swapped.\n", me,
+         procStats.faults, procStats.resident, procStats.swapped);
+  Terminate(me);
+
+  return 0;
+} /* Child */
+
+
+int start5(char *arg)
+{
+  VmStats stats;
+  char name[16];
+  char buf[16];
+  int pid, status;
+  int i;
+
+  printf("start5(): %d children touch 2, 4 and 6 pages.\n", CHILDREN);
+
+  region = VmInit(PAGES, PAGES, FRAMES, 2);
+  assert(region != NULL);
+
+  for (i = 0; i < CHILDREN; i++) {
+    sprintf(name, "Child%d", i);
+    sprintf(buf, "%d", i);
+    Spawn(name, Child, buf, USLOSS_MIN_STACK, 4, &pid);
+    Wait(&pid, &status);
+  }
+
+  assert(VmGetStats(&stats) == 0);
+  assert(stats.faults >= 12);
+  assert(VmGetProcStats(pid, NULL) == -1);
+  printf("start5(): %d faults, %d new, %d pageIns, %d pageOuts, %d replaced.\n",
+         stats.faults, stats.newPages, stats.pageIns, stats.pageOuts,
+         stats.replaced);
+
+  VmCleanup();
+  Terminate(0);
+
+  return 0;
+} /* start5 */
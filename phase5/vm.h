@@ -0,0 +1,74 @@
+/*
+ * Internal data structures for the phase 5 virtual memory system.
+ */
+
+#ifndef _VM_H
+#define _VM_H
+
+// Page table entry states.
+#define UNUSED  500     // Page has never been touched.
+#define INCORE  501     // Page is in a frame.
+#define ONDISK  502     // Page is only in the swap area.
+
+// Message a pager receives to shut down.
+#define PAGER_QUIT  -1
+
+// Age given to a frame when it is referenced (approximate LRU).
+#define LRU_AGE_NEW 0x80
+
+// Each process runs with the MMU tag of its process table slot. Slots
+// past the last tag share VM_NO_TAG, which is never mapped, so their
+// processes can't use the VM region.
+#define VM_NUM_TAGS (MAXPROCS < USLOSS_MMU_MAX_TAG ? MAXPROCS + 1 : USLOSS_MMU_MAX_TAG)
+#define VM_NO_TAG   (VM_NUM_TAGS - 1)
+
+static inline int VmTag(int pid)
+{
+    int slot = proc_slot(pid);
+
+    return (slot < 0 || slot >= VM_NO_TAG) ? VM_NO_TAG : slot;
+}
+
+typedef struct PTE
+{
+    int state;      // See above.
+    int frame;      // Frame that holds the page, or -1.
+    int block;      // Swap block that holds the page, or -1.
+    int cow;        // Page is shared copy-on-write.
+    int heap;       // Page belongs to a live heap allocation.
+} PTE; // Page table entry.
+
+typedef struct VmProc
+{
+    int pid;            // Process that owns this entry, or -1.
+    int numPages;       // Size of the page table.
+    PTE *pageTable;     // One entry per page of the VM region.
+    int heapBreak;      // Lowest heap page; the heap grows down.
+    int *extents;       // Swap extent held for each group of SWAP_CLUSTER
+                        // pages, or -1.
+    int replyMbox;      // Pager replies here once a fault is serviced.
+    int faults;         // Page faults taken by this process.
+} VmProc; // Per-process VM state.
+
+typedef struct FTE
+{
+    int pid;        // A process whose page is in the frame, or -1.
+    int page;       // Page in the frame, or -1.
+    int next;       // Next free frame, or -1.
+    int refs;       // Page tables mapping the frame.
+    int age;        // Sampled reference history (approximate LRU).
+    int lastUse;    // Fault count when last seen referenced (WSClock).
+} FTE; // Frame table entry.
+
+typedef struct FaultMsg
+{
+    int pid;        // Process that faulted, or PAGER_QUIT.
+    int page;       // Page that caused the fault.
+    int cause;      // USLOSS_MMU_FAULT or USLOSS_MMU_ACCESS.
+    int replyMbox;  // Mailbox to send the reply to.
+} FaultMsg; // Message from the fault handler to a pager.
+
+extern void VmProcFork(int pid);
+extern void VmProcRelease(int pid);
+
+#endif /* _VM_H */
@@ -3,6 +3,8 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/file.h>
+#include <sys/stat.h>
+#include <string.h>
 #include <termios.h>
 #include <sgtty.h>
 #include <signal.h>
@@ -19,6 +21,7 @@ FILE *dummy;
 struct termios bar;
 struct termios foo;
 int fd;
+int fifo = 0;
 void echo_out(void);
 
 int
@@ -27,8 +30,14 @@ main(argc, argv)
   char **argv;
 {
   char c, cr = '\r',n;
+  /* -f makes termN.in a FIFO, which usloss reads as a stream */
+  if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+    fifo = 1;
+    argv++;
+    argc--;
+  }
   if (argc != 2) {
-    fprintf(stderr, "Usage: pterm terminal\n");
+    fprintf(stderr, "Usage: pterm [-f] terminal\n");
     exit(1);
   }
   sscanf(argv[1], "%d", &ttyno);
@@ -36,15 +45,23 @@ main(argc, argv)
   signal(SIGINT, reset);
   signal(SIGTSTP, reset);
   sprintf(termname, "term%d.in", ttyno);
-  if((dummy = fopen(termname, "r")) != NULL)
+  /* access() rather than fopen(), which would block on a stale FIFO */
+  if(access(termname, F_OK) == 0)
   {
-    fclose(dummy);
     printf("overwrite %s ?", termname);
     fflush(stdout);
     if(getchar() != 'y') exit(0);
     unlink(termname);
   }
-  fd = open(termname, O_CREAT + O_WRONLY, 00770);
+  if (fifo) {
+    if (mkfifo(termname, 00660) != 0) {
+      perror("pterm: mkfifo");
+      exit(1);
+    }
+    /* O_RDWR so the open doesn't wait for usloss to start reading */
+    fd = open(termname, O_RDWR);
+  } else
+    fd = open(termname, O_CREAT + O_WRONLY, 00770);
   #ifdef NOTDEF
   ioctl(0, TCGETA, &foo);
   ioctl(0, TCGETA, &bar);
@@ -1,28 +1,64 @@
 
 #include <stdio.h>
+#include <stdint.h>
 #include "project.h"
 #include "globals.h"
 #include "dev_alarm.h"
 #include "devices.h"
 
-static int armed = 0;
+/*
+ * Each alarm unit can be armed with a delay in clock ticks, which goes
+ * through the device event queue as before, or with a deadline in
+ * microseconds of virtual time, which is checked on every timer signal
+ * by alarm_check(). The generation number is bumped whenever a unit is
+ * re-armed or cancelled so stale tick events are ignored.
+ */
+typedef struct {
+    int		armed;		/* is an alarm pending? */
+    int		usec;		/* TRUE if deadline is in microseconds. */
+    int		deadline;	/* virtual time (usec) the alarm expires. */
+    int		generation;	/* matches the pending tick event. */
+} AlarmInfo;
+
+static AlarmInfo alarms[ALARM_UNITS];
+
+/* The event argument packs the generation above the unit, unsigned. */
+#define EVENT_ARG(unit, gen)	((void *) (((uintptr_t) (gen) << 8) | (unit)))
+#define EVENT_UNIT(arg)		((int) ((uintptr_t) (arg) & 0xff))
+#define EVENT_GEN(arg)		((int) (((uintptr_t) (arg) >> 8) & 0xffffff))
 
 /*
- *	Initialize the alarm device - nothing to do here, really
+ *	Initialize the alarm device
  */
 dynamic_dcl void alarm_init(void)
 {
+    int unit;
+
+    for (unit = 0; unit < ALARM_UNITS; unit++) {
+	alarms[unit].armed = 0;
+	alarms[unit].usec = 0;
+	alarms[unit].generation = 0;
+    }
 }
 
 /*
- *  Returns the status of the alarm device
+ *  Returns the status of an alarm unit. The remaining time (in
+ *  microseconds) of an armed unit is in the upper bits.
  */
 dynamic_dcl int alarm_get_status(int unit, int *statusPtr)
 {
-    if (unit != 0) 
+    int remaining = 0;
+
+    if ((unit < 0) || (unit >= ALARM_UNITS))
 	return DEV_INVALID;
-    if (armed) {
-	*statusPtr = DEV_BUSY;
+    if (alarms[unit].armed) {
+	remaining = alarms[unit].deadline - virtual_time();
+	if (remaining < 0) {
+	    remaining = 0;
+	} else if (remaining > 0xffffff) {
+	    remaining = 0xffffff;
+	}
+	*statusPtr = (int) (DEV_BUSY | ((unsigned int) remaining << 8));
     } else {
 	*statusPtr = DEV_READY;
     }
@@ -30,26 +66,72 @@ dynamic_dcl int alarm_get_status(int unit, int *statusPtr)
 }
 
 /*
- *  
+ *  Arms or cancels an alarm unit. Arming an armed unit replaces the
+ *  pending alarm.
  */
 dynamic_dcl int alarm_request(int unit, void *arg)
 {
-    int time = (int) arg;
+    int ctrl = (int) arg;
+    int delay;
 
-    if (unit != 0) {
+    if ((unit < 0) || (unit >= ALARM_UNITS)) {
+	return DEV_INVALID;
+    }
+    alarms[unit].generation = (alarms[unit].generation + 1) & 0xffffff;
+    if (ctrl == ALARM_CTRL_CANCEL) {
+	alarms[unit].armed = 0;
+	return DEV_OK;
+    }
+    if (ctrl < 0) {
 	return DEV_INVALID;
     }
-    armed = 1;
-    schedule_int(ALARM_INT, NULL, time);
+    alarms[unit].armed = 1;
+    if (ctrl & ALARM_USEC_FLAG) {
+	delay = ctrl & ~ALARM_USEC_FLAG;
+	alarms[unit].usec = 1;
+	alarms[unit].deadline = virtual_time() + delay;
+    } else {
+	alarms[unit].usec = 0;
+	alarms[unit].deadline = virtual_time() + ctrl * CLOCK_MS * 1000;
+	schedule_int(ALARM_INT, EVENT_ARG(unit, alarms[unit].generation),
+	    ctrl);
+    }
     return DEV_OK;
 }
 
 /*
- *  
+ *  Action for a tick alarm coming off the device event queue. Returns
+ *  the unit, or -1 if the alarm has since been cancelled or re-armed.
  */
 dynamic_dcl int alarm_action(void *arg)
 {
-    armed = 0;
-    return 0;
+    int unit = EVENT_UNIT(arg);
+
+    usloss_sys_assert((unit >= 0) && (unit < ALARM_UNITS),
+	"invalid alarm unit in alarm_action");
+    if (!alarms[unit].armed || alarms[unit].usec ||
+	(alarms[unit].generation != EVENT_GEN(arg))) {
+	return -1;
+    }
+    alarms[unit].armed = 0;
+    return unit;
 }
 
+/*
+ *  Called on every timer signal. Returns the lowest-numbered unit whose
+ *  microsecond deadline has passed (disarming it), or -1 if none.
+ */
+dynamic_dcl int alarm_check(void)
+{
+    int unit;
+    int now = virtual_time();
+
+    for (unit = 0; unit < ALARM_UNITS; unit++) {
+	if (alarms[unit].armed && alarms[unit].usec &&
+	    (alarms[unit].deadline - now <= 0)) {
+	    alarms[unit].armed = 0;
+	    return unit;
+	}
+    }
+    return -1;
+}
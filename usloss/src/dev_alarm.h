@@ -9,6 +9,7 @@ dynamic_dcl void alarm_init(void);
 dynamic_dcl int alarm_get_status(int unit, int *statusPtr);
 dynamic_dcl int alarm_request(int unit, void *request);
 dynamic_dcl int alarm_action(void *arg);
+dynamic_dcl int alarm_check(void);
 
 #endif	/*  _dev_alarm_h */
 
@@ -5,40 +5,81 @@
 #include "dev_clock.h"
 
 /*
- *	Initialize the clock device - nothing to do here, really
+ * The clock is normally periodic and interrupts on every other timer
+ * signal. In tickless mode the periodic ticks are suppressed and the
+ * clock only interrupts once the virtual time programmed by the OS
+ * with CLOCK_CTRL_NEXT has passed (rounded up to the next clock slot);
+ * CLOCK_CTRL_IDLE suppresses it altogether until it is reprogrammed.
+ */
+static int tickless = 0;	/* TRUE if periodic ticks are off */
+static int armed = 0;		/* TRUE if a one-shot event is pending */
+static int deadline;		/* virtual time (usec) of that event */
+
+/*
+ *	Initialize the clock device
  */
 dynamic_dcl void clock_init(void)
 {
+    tickless = 0;
+    armed = 0;
 }
 
 /*
- *  Returns the status of the clock device - always DEV_READY
+ *  Returns the status of the clock device - DEV_BUSY if a tickless
+ *  event is pending, DEV_READY otherwise
  */
 dynamic_dcl int clock_get_status(int unit, int *statusPtr)
 {
     if (unit != 0) {
 	return DEV_INVALID;
     }
-    *statusPtr = DEV_READY;
+    *statusPtr = armed ? DEV_BUSY : DEV_READY;
     return DEV_OK;
 }
 
 /*
- *  There are really no requests that can be made of the clock.....
+ *  Selects periodic or tickless operation and programs the next
+ *  tickless event.
  */
 dynamic_dcl int clock_request(int unit, void *arg)
 {
+    int ctrl = (int) arg;
+
     if (unit != 0) {
 	return DEV_INVALID;
     }
+    /* IDLE is the only negative control word; others would pass as NEXT */
+    if (ctrl < 0 && ctrl != CLOCK_CTRL_IDLE) {
+	return DEV_INVALID;
+    }
+    if (ctrl == CLOCK_CTRL_PERIODIC) {
+	tickless = 0;
+	armed = 0;
+    } else if (ctrl == CLOCK_CTRL_IDLE) {
+	tickless = 1;
+	armed = 0;
+    } else if (ctrl & CLOCK_NEXT_FLAG) {
+	tickless = 1;
+	armed = 1;
+	deadline = virtual_time() + (ctrl & ~CLOCK_NEXT_FLAG);
+    } else {
+	return DEV_INVALID;
+    }
     return DEV_OK;
 }
 
 /*
- *  And, it doesn't really do much here, either....
+ *  Called on each clock slot. Returns -1 if the clock interrupt should
+ *  be suppressed, 0 otherwise.
  */
 dynamic_dcl int clock_action(void)
 {
-    return 0;
+    if (!tickless) {
+	return 0;
+    }
+    if (armed && (deadline - virtual_time() <= 0)) {
+	armed = 0;
+	return 0;
+    }
+    return -1;
 }
-
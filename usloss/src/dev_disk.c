@@ -14,6 +14,29 @@
 
 //#define LOGGING_DISK_IO
 
+#ifdef DISK_CACHE
+/*
+ * Write-back track cache. Each unit keeps DISK_CACHE_LINES whole tracks
+ * in memory, with per-sector valid and dirty bits (DISK_TRACK_SIZE must
+ * fit in an int). Dirty sectors are written back when their track is
+ * evicted and when the simulator halts. If DISK_CACHE_TIMING is defined
+ * the cache behaves like a drive's onboard cache and a seek to a cached
+ * track completes in a single tick; otherwise it only saves host I/O and
+ * simulated timing is unchanged. The Makefile leaves it off: a run that
+ * ends in abort() instead of halt() loses the sectors still dirty.
+ */
+#define DISK_CACHE_LINES	8
+
+typedef struct
+{
+	int track;				// Cached track, -1 if line is empty.
+	int valid;				// Bitmask of sectors holding disk data.
+	int dirty;				// Bitmask of sectors not yet written back.
+	unsigned int lastUse;	// LRU stamp.
+	char data[DISK_TRACK_SIZE * DISK_SECTOR_SIZE];
+} TrackCache;
+#endif
+
 typedef struct
 {
 	int fd;					// Open fd for disk file.
@@ -21,10 +44,145 @@ typedef struct
 	int currentTrack;		// head position
 	int status;				// Disk's status
 	device_request request; // Current request
+#ifdef DISK_CACHE
+	TrackCache cache[DISK_CACHE_LINES];
+	unsigned int useClock;	// Source of LRU stamps.
+	int hits;				// Sector accesses satisfied by the cache.
+	int misses;				// Sector accesses that went to the file.
+#endif
 } DiskInfo;
 
 static DiskInfo disks[DISK_UNITS];
 
+#ifdef DISK_CACHE
+/*
+ *  Writes the dirty sectors of a cache line back to the disk file,
+ *  coalescing runs of adjacent dirty sectors into a single write.
+ */
+static void cache_writeback(int unit, TrackCache *line)
+{
+	int first;
+	int last;
+	int err_return;
+	off_t base;
+
+	base = (off_t)line->track * DISK_TRACK_SIZE * DISK_SECTOR_SIZE;
+	first = 0;
+	while (line->dirty != 0)
+	{
+		while ((line->dirty & (1 << first)) == 0)
+			first++;
+		last = first;
+		while ((last + 1 < DISK_TRACK_SIZE) &&
+			   (line->dirty & (1 << (last + 1))))
+			last++;
+		err_return = pwrite(disks[unit].fd,
+							&line->data[first * DISK_SECTOR_SIZE],
+							(last - first + 1) * DISK_SECTOR_SIZE,
+							base + first * DISK_SECTOR_SIZE);
+		usloss_sys_assert(err_return == (last - first + 1) * DISK_SECTOR_SIZE,
+						  "error writing back disk cache");
+		line->dirty &= ~(((1 << (last - first + 1)) - 1) << first);
+		first = last + 1;
+	}
+}
+
+/*
+ *  Returns the cache line holding the given track, or NULL if the
+ *  track is not cached.
+ */
+static TrackCache *cache_lookup(int unit, int track)
+{
+	int i;
+
+	for (i = 0; i < DISK_CACHE_LINES; i++)
+	{
+		if (disks[unit].cache[i].track == track)
+			return &disks[unit].cache[i];
+	}
+	return NULL;
+}
+
+/*
+ *  Returns the cache line for the given track, evicting the least
+ *  recently used line if the track is not already cached. A newly
+ *  allocated line holds no valid sectors.
+ */
+static TrackCache *cache_get(int unit, int track)
+{
+	TrackCache *line;
+	TrackCache *victim;
+	int i;
+
+	line = cache_lookup(unit, track);
+	if (line == NULL)
+	{
+		victim = &disks[unit].cache[0];
+		for (i = 1; i < DISK_CACHE_LINES; i++)
+		{
+			line = &disks[unit].cache[i];
+			if ((victim->track != -1) &&
+				((line->track == -1) || (line->lastUse < victim->lastUse)))
+				victim = line;
+		}
+		line = victim;
+		if (line->track != -1)
+			cache_writeback(unit, line);
+		line->track = track;
+		line->valid = 0;
+		line->dirty = 0;
+	}
+	line->lastUse = ++disks[unit].useClock;
+	return line;
+}
+
+/*
+ *  Performs a sector read or write through the cache. A read miss
+ *  fills the whole track with one read of the disk file, so later
+ *  reads of the same track are hits. Writes only mark the sector dirty.
+ */
+static void cache_io(int unit, int opr, int sector, char *buffer)
+{
+	TrackCache *line;
+	char *sectorPtr;
+	char trackBuf[DISK_TRACK_SIZE * DISK_SECTOR_SIZE];
+	int err_return;
+	int i;
+
+	line = cache_get(unit, disks[unit].currentTrack);
+	sectorPtr = &line->data[sector * DISK_SECTOR_SIZE];
+	if (opr == DISK_WRITE)
+	{
+		memcpy(sectorPtr, buffer, DISK_SECTOR_SIZE);
+		line->valid |= 1 << sector;
+		line->dirty |= 1 << sector;
+		disks[unit].hits++;
+		return;
+	}
+	if (line->valid & (1 << sector))
+	{
+		disks[unit].hits++;
+	}
+	else
+	{
+		disks[unit].misses++;
+		err_return = pread(disks[unit].fd, trackBuf, sizeof(trackBuf),
+						   (off_t)line->track * sizeof(trackBuf));
+		usloss_sys_assert(err_return == sizeof(trackBuf),
+						  "error reading from disk file");
+		/*  Don't clobber sectors that were written but not flushed */
+		for (i = 0; i < DISK_TRACK_SIZE; i++)
+		{
+			if ((line->valid & (1 << i)) == 0)
+				memcpy(&line->data[i * DISK_SECTOR_SIZE],
+					   &trackBuf[i * DISK_SECTOR_SIZE], DISK_SECTOR_SIZE);
+		}
+		line->valid = (1 << DISK_TRACK_SIZE) - 1;
+	}
+	memcpy(buffer, sectorPtr, DISK_SECTOR_SIZE);
+}
+#endif /* DISK_CACHE */
+
 /*
  *  Initialize all disk handling code.
  */
@@ -53,10 +211,44 @@ dynamic_fun void disk_init(void)
 							  (DISK_TRACK_SIZE * DISK_SECTOR_SIZE);
 			disks[i].currentTrack = 0;
 			disks[i].status = DEV_READY;
+#ifdef DISK_CACHE
+			{
+				int j;
+
+				for (j = 0; j < DISK_CACHE_LINES; j++)
+					disks[i].cache[j].track = -1;
+				disks[i].useClock = 0;
+				disks[i].hits = 0;
+				disks[i].misses = 0;
+			}
+#endif
 		}
 	}
 }
 
+/*
+ *  Called when the simulator halts. Writes any dirty cached sectors
+ *  back to the disk files.
+ */
+dynamic_fun void disk_halt(void)
+{
+#ifdef DISK_CACHE
+	int i;
+	int j;
+
+	for (i = 0; i < DISK_UNITS; i++)
+	{
+		if (disks[i].fd == -1)
+			continue;
+		for (j = 0; j < DISK_CACHE_LINES; j++)
+		{
+			if (disks[i].cache[j].track != -1)
+				cache_writeback(i, &disks[i].cache[j]);
+		}
+	}
+#endif
+}
+
 /*
  *  Returns the current device status of the disk.  Resets the status to
  *  DEV_READY if the last I/O operation resulted in an error.
@@ -112,6 +304,15 @@ dynamic_fun int disk_request(int unit, void *arg)
 		delay = 1;
 	if (delay > 3)
 		delay = 3;
+#if defined(DISK_CACHE) && defined(DISK_CACHE_TIMING)
+	/*
+	 * The onboard cache makes a seek to a cached track as fast as any
+	 * other operation.
+	 */
+	if ((request->opr == DISK_SEEK) &&
+		(cache_lookup(unit, (int)request->reg1) != NULL))
+		delay = 1;
+#endif
 	schedule_int(DISK_INT, (void *)unit, delay);
 	rc = DEV_OK;
 done:
@@ -158,10 +359,16 @@ dynamic_fun int disk_action(void *arg)
 		break;
 	case DISK_READ:
 	case DISK_WRITE:
-		if (((int)request->reg1) >= DISK_TRACK_SIZE)
+		if ((((int)request->reg1) >= DISK_TRACK_SIZE) ||
+			(((int)request->reg1) < 0))
 			status = DEV_ERROR;
 		else
 		{
+#ifdef DISK_CACHE
+			cache_io(unit, request->opr, (int)request->reg1,
+					 (char *)request->reg2);
+			break;
+#endif
 			seek_loc = ((disks[unit].currentTrack * DISK_TRACK_SIZE) +
 						((int)request->reg1)) *
 					   DISK_SECTOR_SIZE;
@@ -200,6 +407,15 @@ dynamic_fun int disk_action(void *arg)
 	case DISK_TRACKS:
 		*((int *)request->reg1) = disks[unit].tracks;
 		break;
+	case DISK_STATS:
+#ifdef DISK_CACHE
+		*((int *)request->reg1) = disks[unit].hits;
+		*((int *)request->reg2) = disks[unit].misses;
+#else
+		*((int *)request->reg1) = 0;
+		*((int *)request->reg2) = 0;
+#endif
+		break;
 	default:
 		usloss_usr_assert(0, "Illegal disk request operation");
 		break;
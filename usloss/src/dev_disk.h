@@ -9,6 +9,7 @@ dynamic_dcl void disk_init(void);
 dynamic_dcl int disk_get_status(int unit, int *status);
 dynamic_dcl int disk_request(int unit, void *request);
 dynamic_dcl int disk_action(void *arg);
+dynamic_dcl void disk_halt(void);
 
 #endif	/*  _dev_disk_h */
 
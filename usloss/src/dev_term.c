@@ -2,10 +2,35 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "project.h"
 #include "globals.h"
 #include "dev_term.h"
 
+/*
+ * Transmitted characters are normally held in a per-unit buffer and
+ * written to the output file when a newline is sent, when the buffer
+ * fills, on each clock tick and when the simulator halts. Define
+ * TERM_STRICT_XMIT to flush the file after every character instead.
+ * Either way the xmit status and interrupts behave the same.
+ */
+#define TERM_XMIT_BUF	4096
+
+/*
+ * A termN.in that is a FIFO, a Unix-domain socket or a character device
+ * (e.g. a pseudo-terminal slave) is treated as a stream instead of a
+ * file. Stream units are polled once per term_action() and everything
+ * that is available is read into a per-unit ring buffer, from which
+ * characters are then consumed.
+ */
+#define TERM_RING_SIZE	4096
+
 /*
  * These structures keep track of the status of each terminal. 
  */
@@ -14,6 +39,18 @@ typedef struct {
     FILE	*outputPtr;	/* output stream. */
     int		status;		/* its status register. */
     int		control;	/* its control register. */
+    int		pending;	/* # chars buffered but not flushed. */
+    char	xmitBuf[TERM_XMIT_BUF];	/* output stream buffer. */
+    int		blockStatus;	/* block port status register. */
+    char	*xmitBlock;	/* block being transmitted, if any. */
+    int		xmitLen;	/* its length. */
+    char	*recvBlock;	/* block being received into, if any. */
+    int		recvLen;	/* its size. */
+    int		recvCount;	/* # chars received into it so far. */
+    int		inputFd;	/* input stream fd, -1 if file-backed. */
+    int		ringHead;	/* next char to consume from ring. */
+    int		ringCount;	/* # chars in ring. */
+    char	ring[TERM_RING_SIZE];	/* stream input ring buffer. */
 } TermInfo;
 
 static TermInfo terms[TERM_UNITS];
@@ -34,6 +71,14 @@ static TermInfo terms[TERM_UNITS];
     (status) &= ~0xff00;\
     (status) |= (((ch) & 0xff) << 8);
 
+#define SET_BLOCK_XMIT(status, value, count)\
+    (status) &= ~(0xc | 0xfff00);\
+    (status) |= (((value) & 0x3) << 2) | (((count) & 0xfff) << 8);
+
+#define SET_BLOCK_RECV(status, value, count)\
+    (status) &= ~(0x3 | 0xfff00000);\
+    (status) |= ((value) & 0x3) | (((count) & 0xfff) << 20);
+
 /* 
  *  Open a file or "/dev/null" if file nonexistent
  */
@@ -49,6 +94,41 @@ static FILE *safeopen(char *fname, char *fmode)
     return new_file;
 }
 
+/*
+ *  Opens a stream-backed input (FIFO, Unix socket or character device)
+ *  in non-blocking mode. Returns -1 if the file is a regular file or
+ *  doesn't exist, in which case it is opened with safeopen().
+ */
+static int streamopen(char *fname)
+{
+    struct stat inode;
+    struct sockaddr_un addr;
+    int fd;
+    int err_return;
+
+    if (stat(fname, &inode) != 0)
+	return -1;
+    if (S_ISFIFO(inode.st_mode)) {
+	fd = open(fname, O_RDONLY | O_NONBLOCK);
+    } else if (S_ISCHR(inode.st_mode)) {
+	fd = open(fname, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+    } else if (S_ISSOCK(inode.st_mode)) {
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	usloss_sys_assert(fd != -1, "couldn't create terminal socket");
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, fname, sizeof(addr.sun_path) - 1);
+	err_return = connect(fd, (struct sockaddr *) &addr, sizeof(addr));
+	usloss_sys_assert(err_return == 0, "couldn't connect terminal socket");
+	err_return = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	usloss_sys_assert(err_return != -1, "couldn't set terminal socket mode");
+    } else {
+	return -1;
+    }
+    usloss_sys_assert(fd != -1, "couldn't open terminal stream");
+    return fd;
+}
+
 /*
  *	Initialize the terminal device (a single device with four units).
  */
@@ -62,12 +142,20 @@ dynamic_dcl void term_init(void)
     {
 	terms[count].control = 0;
 	terms[count].status = 0;
+	terms[count].blockStatus = 0;
+	terms[count].xmitBlock = NULL;
+	terms[count].recvBlock = NULL;
     }
     /*  Open pseudo-terminal files - output first */
     for (count = 0; count < 4; count++)
     {
 	filename[4] = '0' + count;
 	terms[count].outputPtr = safeopen(filename, "w");
+	terms[count].pending = 0;
+#ifndef TERM_STRICT_XMIT
+	setvbuf(terms[count].outputPtr, terms[count].xmitBuf, _IOFBF,
+	    TERM_XMIT_BUF);
+#endif
     }
 
     /*  Now open the input files */
@@ -75,21 +163,120 @@ dynamic_dcl void term_init(void)
     for (count = 0; count < 4; count++)
     {
 	filename[4] = '0' + count;
-	terms[count].inputPtr = safeopen(filename, "r");
+	terms[count].ringHead = 0;
+	terms[count].ringCount = 0;
+	terms[count].inputFd = streamopen(filename);
+	if (terms[count].inputFd == -1)
+	    terms[count].inputPtr = safeopen(filename, "r");
+	else
+	    terms[count].inputPtr = NULL;
     }
 }
 
 /*
- *  Special character input routine for buffered input. If getc()
+ *  Checks the stream-backed units for input with a single poll() and
+ *  reads everything available on the ready ones into their rings.
+ */
+static void term_poll(void)
+{
+    struct pollfd fds[TERM_UNITS];
+    int units[TERM_UNITS];
+    int nfds = 0;
+    int unit;
+    int i;
+    int tail;
+    int space;
+    int n;
+
+    for (unit = 0; unit < TERM_UNITS; unit++) {
+	if ((terms[unit].inputFd != -1) &&
+	    (terms[unit].ringCount < TERM_RING_SIZE)) {
+	    fds[nfds].fd = terms[unit].inputFd;
+	    fds[nfds].events = POLLIN;
+	    fds[nfds].revents = 0;
+	    units[nfds++] = unit;
+	}
+    }
+    if ((nfds == 0) || (poll(fds, nfds, 0) <= 0))
+	return;
+    for (i = 0; i < nfds; i++) {
+	if ((fds[i].revents & POLLIN) == 0)
+	    continue;
+	unit = units[i];
+	while (terms[unit].ringCount < TERM_RING_SIZE) {
+	    tail = (terms[unit].ringHead + terms[unit].ringCount) %
+		TERM_RING_SIZE;
+	    space = TERM_RING_SIZE - terms[unit].ringCount;
+	    if (space > TERM_RING_SIZE - tail)
+		space = TERM_RING_SIZE - tail;
+	    n = read(terms[unit].inputFd, &terms[unit].ring[tail], space);
+	    if (n <= 0) {
+		usloss_sys_assert((n == 0) || (errno == EAGAIN) ||
+		    (errno == EINTR) || (errno == EIO),
+		    "error reading terminal stream");
+		break;
+	    }
+	    terms[unit].ringCount += n;
+	}
+    }
+}
+
+/*
+ *  Writes any buffered output for a unit to its file.
+ */
+static void term_flush(int unit)
+{
+    int err_return;
+
+    if (terms[unit].pending == 0)
+	return;
+    err_return = fflush(terms[unit].outputPtr);
+    usloss_sys_assert(err_return == 0, 
+	"error on fflush of terminal device");
+    terms[unit].pending = 0;
+}
+
+/*
+ *  Called on every clock tick so buffered output never lags far behind
+ *  the simulated transmission.
+ */
+dynamic_fun void term_tick(void)
+{
+    int unit;
+
+    for (unit = 0; unit < TERM_UNITS; unit++)
+	term_flush(unit);
+}
+
+/*
+ *  Called when the simulator halts.
+ */
+dynamic_fun void term_halt(void)
+{
+    term_tick();
+}
+
+/*
+ *  Special character input routine. Stream-backed units take the next
+ *  character from their ring. For files, if getc()
  *  indicates that EOF has been reached, a read() is attempted to
  *  catch any character that may have been appended since the EOF
  *  was detected. This is a bit of a kludge, but it works.
  */
-static int nextchr(FILE *stream)
+static int nextchr(int unit)
 {
+    FILE *stream = terms[unit].inputPtr;
     int c;
     char ch;
 
+    if (terms[unit].inputFd != -1) {
+	if (terms[unit].ringCount == 0)
+	    return EOF;
+	c = (unsigned char) terms[unit].ring[terms[unit].ringHead];
+	terms[unit].ringHead = (terms[unit].ringHead + 1) % TERM_RING_SIZE;
+	terms[unit].ringCount--;
+	return c;
+    }
     c = getc(stream);
     if (c != EOF) 
 	return c;
@@ -105,6 +292,15 @@ static int nextchr(FILE *stream)
 dynamic_dcl int term_get_status(int unit, int *statusPtr)
 {
 
+    if (TERM_IS_BLOCK(unit)) {
+	unit = TERM_UNIT(unit);
+	if ((unit < 0) || (unit > 3)) {
+	    return DEV_INVALID;
+	}
+	*statusPtr = terms[unit].blockStatus;
+	terms[unit].blockStatus &= ~(TERM_BLOCK_XMIT_DONE|TERM_BLOCK_RECV_DONE);
+	return DEV_OK;
+    }
     if ((unit < 0) || (unit > 3)) {
 	return DEV_INVALID;
     }
@@ -118,6 +314,98 @@ dynamic_dcl int term_get_status(int unit, int *statusPtr)
     return DEV_OK;
 }
 
+/*
+ *  Starts a block transfer on a unit's block port. Only one transfer
+ *  per direction may be outstanding.
+ */
+static int term_block_request(int unit, device_request *request)
+{
+    int len;
+
+    if ((unit < 0) || (unit > 3) || (request == NULL)) {
+	return DEV_INVALID;
+    }
+    len = (int) request->reg2;
+    if ((request->reg1 == NULL) || (len < 0) || (len > TERM_BLOCK_MAX)) {
+	return DEV_INVALID;
+    }
+    switch (request->opr) {
+      case TERM_XMIT_BLOCK:
+	if (terms[unit].xmitBlock != NULL) {
+	    return DEV_BUSY;
+	}
+	terms[unit].xmitBlock = (char *) request->reg1;
+	terms[unit].xmitLen = len;
+	SET_BLOCK_XMIT(terms[unit].blockStatus, DEV_BUSY, 0);
+	break;
+      case TERM_RECV_BLOCK:
+	if (terms[unit].recvBlock != NULL) {
+	    return DEV_BUSY;
+	}
+	terms[unit].recvBlock = (char *) request->reg1;
+	terms[unit].recvLen = len;
+	terms[unit].recvCount = 0;
+	SET_BLOCK_RECV(terms[unit].blockStatus, DEV_BUSY, 0);
+	break;
+      default:
+	return DEV_INVALID;
+    }
+    return DEV_OK;
+}
+
+/*
+ *  Transmits the pending block on a unit. Returns TRUE when a
+ *  transfer completed.
+ */
+static int term_block_xmit(int unit)
+{
+    int err_return;
+    int len;
+
+    if (terms[unit].xmitBlock == NULL) {
+	return FALSE;
+    }
+    len = terms[unit].xmitLen;
+    err_return = fwrite(terms[unit].xmitBlock, 1, len, terms[unit].outputPtr);
+    usloss_sys_assert(err_return == len, 
+	"error on fwrite to terminal device");
+    terms[unit].pending += len;
+#ifndef TERM_STRICT_XMIT
+    if (((len > 0) && (terms[unit].xmitBlock[len - 1] == '\n')) ||
+	(terms[unit].pending >= TERM_XMIT_BUF))
+#endif
+	term_flush(unit);
+    terms[unit].xmitBlock = NULL;
+    SET_BLOCK_XMIT(terms[unit].blockStatus, DEV_READY, len);
+    terms[unit].blockStatus |= TERM_BLOCK_XMIT_DONE;
+    return TRUE;
+}
+
+/*
+ *  Receives whatever input is available into the pending block on a
+ *  unit. Returns TRUE when the block is complete, i.e. a newline was
+ *  received or the block is full.
+ */
+static int term_block_recv(int unit)
+{
+    int in_char;
+
+    while (terms[unit].recvCount < terms[unit].recvLen) {
+	in_char = nextchr(unit);
+	if ((in_char == EOF) || ((char) in_char == '@')) {
+	    return FALSE;
+	}
+	terms[unit].recvBlock[terms[unit].recvCount++] = in_char;
+	if ((char) in_char == '\n') {
+	    break;
+	}
+    }
+    SET_BLOCK_RECV(terms[unit].blockStatus, DEV_READY, terms[unit].recvCount);
+    terms[unit].blockStatus |= TERM_BLOCK_RECV_DONE;
+    terms[unit].recvBlock = NULL;
+    return TRUE;
+}
+
 /*
  *  Writes to a terminals control register. If a character is being 
  *  sent and the device is not busy, then write the character to the file 
@@ -129,6 +417,9 @@ dynamic_dcl int term_request(int unit, void *arg)
     int	ch;
     int req = (int) arg;
 
+    if (TERM_IS_BLOCK(unit)) {
+	return term_block_request(TERM_UNIT(unit), (device_request *) arg);
+    }
     if ((unit < 0) || (unit > 3)) {
 	return DEV_INVALID;
     }
@@ -137,14 +428,19 @@ dynamic_dcl int term_request(int unit, void *arg)
      * Check to see if we are supposed to send a character.
      */
     if (req & 0x1) {
+	if (terms[unit].xmitBlock != NULL) {
+	    return DEV_BUSY;
+	}
 	if (TERM_STAT_XMIT(terms[unit].status) == DEV_READY) {
 		ch = (req >> 8) & 0xff;
 		err_return = putc(ch, terms[unit].outputPtr);
 		usloss_sys_assert(err_return != EOF, 
 			"error on putc to terminal device");
-		err_return = fflush(terms[unit].outputPtr);
-		usloss_sys_assert(err_return == 0, 
-			"error on fflush of terminal device");
+		terms[unit].pending++;
+#ifndef TERM_STRICT_XMIT
+		if ((ch == '\n') || (terms[unit].pending >= TERM_XMIT_BUF))
+#endif
+		    term_flush(unit);
 		SET_XMIT_STATUS(terms[unit].status, DEV_BUSY);
 	} else if (TERM_STAT_XMIT(terms[unit].status) == DEV_BUSY) {
 	    return DEV_BUSY;
@@ -162,29 +458,52 @@ dynamic_dcl int term_action(void *arg)
     static int unit = -1;
     int in_char;
     int result = -1;
+    int recvBlocked = FALSE;
 
-    /*  Select the pseudoterminal to read from and get next character */ 
+    /*  Pick up any stream input, then select the pseudoterminal to read from */
+    term_poll();
     unit = (unit + 1) % 4;
-    in_char = nextchr(terms[unit].inputPtr);
-    //terms[unit].status = 0;
 
-    /*  If we are not at EOF or the character is not an '@' sign (which
-	means pause the input), then set termPtr so subsequent calls
-	to term_get_status return the status. */
-    if ((in_char != EOF) && ((char) in_char != '@'))
-    {
-		SET_CHAR(terms[unit].status, in_char);
-		SET_RECV_STATUS(terms[unit].status, DEV_BUSY);
-		/*
-		 * Do not return a unit number if receive interrupts are not
-		 * enabled.
-		 */
-		if (terms[unit].control & 0x2) {
-			result = unit;
-		}
-    }
-    else {
-    	SET_RECV_STATUS(terms[unit].status, DEV_READY);
+    /*
+     * A unit with block transfers outstanding moves whole blocks and
+     * raises one interrupt per completed transfer on its block port.
+     * A pending block receive owns the input, but character transmits
+     * still complete below.
+     */
+    if (terms[unit].xmitBlock != NULL || terms[unit].recvBlock != NULL) {
+	int done = term_block_xmit(unit);
+
+	if (terms[unit].recvBlock != NULL) {
+	    done |= term_block_recv(unit);
+	    recvBlocked = TRUE;
+	}
+	if (done) {
+	    return TERM_BLOCK_UNIT(unit);
+	}
+    }
+
+    if (!recvBlocked) {
+	/*  Get next character */
+	in_char = nextchr(unit);
+
+	/*  If we are not at EOF or the character is not an '@' sign (which
+	    means pause the input), then set termPtr so subsequent calls
+	    to term_get_status return the status. */
+	if ((in_char != EOF) && ((char) in_char != '@'))
+	{
+		    SET_CHAR(terms[unit].status, in_char);
+		    SET_RECV_STATUS(terms[unit].status, DEV_BUSY);
+		    /*
+		     * Do not return a unit number if receive interrupts are not
+		     * enabled.
+		     */
+		    if (terms[unit].control & 0x2) {
+			    result = unit;
+		    }
+	}
+	else {
+	    SET_RECV_STATUS(terms[unit].status, DEV_READY);
+	}
     }
     /* 
      * If the xmit side is busy, then we just sent a character. Mark
@@ -9,6 +9,8 @@ dynamic_dcl void term_init(void);
 dynamic_dcl int term_get_status(int unit, int *status);
 dynamic_dcl int term_request(int unit, void *arg);
 dynamic_dcl int term_action(void *arg);
+dynamic_dcl void term_tick(void);
+dynamic_dcl void term_halt(void);
 
 #endif	/*  _dev_term_h */
 
@@ -36,6 +36,16 @@ dynamic_fun void devices_init(void)
     }
 }
 
+/*
+ *  Called when the simulator halts so the devices can flush any state
+ *  they are holding back from the host files.
+ */
+dynamic_fun void devices_halt(void)
+{
+    disk_halt();
+    term_halt();
+}
+
 /*
  *  Schedule an interrupt for a given number of clock ticks (must be < 255)
  *  in the future.  When two interrupts are scheduled for the same tick,
@@ -76,12 +86,27 @@ dynamic_fun void dispatch_int(void)
     int unit_num = -1;
     void *arg;
 
+    /*  Deliver any microsecond alarms that have expired.  The alarm is a
+	higher priority than every device in the event queue, and
+	deadlines are checked on every timer signal. */
+    while ((unit_num = alarm_check()) != -1)
+    {
+	waiting = 0;
+	if (int_vec[ALARM_INT] == NULL) {
+	    rpt_sim_trap("USLOSS_IntVec[USLOSS_ALARM_INT] is NULL!\n");
+	}
+	(*int_vec[ALARM_INT])(ALARM_DEV, (void *) unit_num);
+    }
+
     /*  Update and check the 'tick' variable to see if this is a clock
 	interrupt */
     tick = ~tick;
     if (tick)
     {
-	clock_action();
+	term_tick();
+	if (clock_action() == -1) {
+	    return;
+	}
 	if (int_vec[CLOCK_INT] == NULL) {
 	    rpt_sim_trap("USLOSS_IntVec[USLOSS_CLOCK_INT] is NULL!\n");
 	}
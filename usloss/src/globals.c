@@ -9,6 +9,7 @@
 #include "globals.h"
 #include "main.h"
 #include "sig_ints.h"
+#include "devices.h"
 #include "usloss.h"
 
 dynamic_def(unsigned int current_psr = PSR_MAGIC);
@@ -87,7 +88,9 @@ void psr_set(unsigned int new)
 	//rpt_sim_trap("USLOSS psr_set: invalid PSR: user mode with interrupts off.\n");
     }
     current_psr = PSR_MAGIC | new;
-    if (current_psr & PSR_CURRENT_INT) {
+    if ((current_psr & PSR_CURRENT_INT) && (current_psr & PSR_CURRENT_MODE)) {
+	int_on_shadowed();
+    } else if (current_psr & PSR_CURRENT_INT) {
 	int_on();
     }
     check_interrupts();
@@ -173,6 +176,15 @@ int sys_clock(void)
     return value;
 }
 
+/*
+ *  Current virtual time in microseconds. This is the clock sys_clock()
+ *  reports, but reading it doesn't charge the caller for the call.
+ */
+dynamic_fun int virtual_time(void)
+{
+    return pclock_ticks * ALARM_TIME + partial_ticks;
+}
+
 /*
  *  Stops the simulator - called by the operating system
  */
@@ -183,6 +195,7 @@ void halt(int dump)
     (void) int_off();
     check_kernel_mode("USLOSS halt");
     dumpcore = dump;
+    devices_halt();
     err_return = setcontext(&finish_context.context);	
     /*  Should never pass here */
     usloss_sys_assert(err_return != -1, "error resuming finishing context");
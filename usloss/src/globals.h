@@ -30,6 +30,7 @@ dynamic_dcl void rpt_cond(char *cond, char *file, int line, char *msg);
 dynamic_dcl void vrpt_cond(char *msg, ...);
 dynamic_dcl void rpt_sim_trap(char *msg);
 dynamic_dcl int atleast(int num);
+dynamic_dcl int virtual_time(void);
 dynamic_dcl void check_interrupts(void);
 dynamic_dcl void debug(char *msg, ...);
 dynamic_dcl void psr_valid(void);
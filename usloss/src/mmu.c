@@ -7,9 +7,36 @@
  *      mprotect. You can configure it so that there are fewer mappings
  *      than virtual pages, (i.e. a TB), and you can associate a tag
  *      with each mapping. Each mapping can also be read-only or read-write.
+ *
+ *      In USLOSS_MMU_MODE_PREBUILT mode each tag also has a shadow
+ *      region in which its host mappings are kept while it isn't the
+ *      current tag, so a tag switch just swaps two regions with mremap
+ *      instead of remapping every page.
+ *
+ *      The number of tags is set with USLOSS_MmuSetNumTags. A tag's page
+ *      table (and shadow region) is allocated the first time the tag is
+ *      used. Otherwise the host mappings are built lazily: a tag switch
+ *      just drops the old tag's mappings, and each page of the new tag is
+ *      mapped in by the fault on its first access.
+ *
+ *      USLOSS_MmuSetTlb adds a TLB. Only pages of the current tag that
+ *      are in the TLB have real access, so every TLB miss faults and the
+ *      handler loads the page into the TLB, evicting another page in the
+ *      same set if need be.
+ *
+ *      USLOSS_MmuMapLarge maps a large page, an aligned run of pages that
+ *      is handled as a unit: it is mapped in, protected, and has its
+ *      access bits set as a whole, so it takes one fault where its pages
+ *      would take one each.
+ *
+ *      Compile with MMU_VALIDATE to check the host mappings and the
+ *      frame reverse maps against the page tables on every change.
+ *      This makes each access-bit fault O(numPages).
  */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <string.h>
@@ -21,8 +48,8 @@
 #include "globals.h"
 #include <setjmp.h>
 #include <fcntl.h>
+#include <errno.h>
 
-extern void set_timer(void);
 
 /*
  * Per-page information. The virtProt and realProt are used to implement
@@ -36,16 +63,32 @@ typedef struct MMUPage {
     int         frame;          /* Frame that contains page */
     int         virtProt;       /* Protection on virtual page */
     int         realProt;       /* Protection of real page. */
+    int         next;           /* Next/previous page mapped to the same */
+    int         prev;           /* frame, as a PageRef, or -1 */
+    int         tlb;            /* TLB entry holding the page, or -1 */
+    int         large;          /* Page is part of a large page */
 } MMUPage;
 
 /*
- * Per-frame information.
+ * Per-frame information. Every mapped page is on the list of its
+ * frame, so changing the access bits only touches the pages that
+ * map the frame.
  */
 typedef struct MMUFrame {
     int         access;         /* Access bits for frame */
+    int         head;           /* First page mapped to frame (PageRef) */
+    int         large;          /* # of large pages mapped to frame */
 } MMUFrame;
 
 
+/*
+ * A TLB entry. The stamp orders the entries of a set for replacement.
+ */
+typedef struct MMUTlbEntry {
+    int         ref;            /* Page in the entry (PageRef), or -1 */
+    unsigned long stamp;        /* When loaded (FIFO) or last used (LRU) */
+} MMUTlbEntry;
+
 /*
  * Global info for the MMU.
  */
@@ -54,15 +97,38 @@ typedef struct MMUInfo {
     int         numFrames;      
     MMUFrame    *frames;
     int         numPages;
-    MMUPage     *pages[USLOSS_MMU_NUM_TAG];
+    int         numTags;
+    MMUPage     **pages;        /* Per-tag page tables, NULL until used */
     int         maxMaps;        /* max # valid mappings */
     int         numMaps;        /* current # of mappings */
     int         cause;          /* Cause of the last MMU exception */
     void        *region;        /* aligned vm region */
     int         tag;            /* Current tag */
+    int         mode;           /* USLOSS_MMU_MODE_* flags */
+    void        **shadows;      /* Per-tag regions, indexed by tag + 1
+                                 * (tag -1 has no pages), NULL until used */
+    int         pagemap;        /* /proc/self/pagemap in harvest mode */
+    int         clearRefs;      /* /proc/self/clear_refs in harvest mode */
+    int         softDirty;      /* Host tracks writes with soft-dirty bits */
+    uint64_t    *entries;       /* Buffer of numPages pagemap entries */
+    MMUTlbEntry *tlb;           /* TLB, or NULL if there isn't one */
+    int         tlbEntries;
+    int         tlbWays;        /* Entries per set */
+    int         tlbFlags;       /* USLOSS_MMU_TLB_* policy and flags */
+    int         largePages;     /* Pages in a large page, or 0 */
+    unsigned long tlbClock;     /* Stamp of the last TLB load or hit */
+    unsigned int tlbSeed;       /* For USLOSS_MMU_TLB_RANDOM */
+    USLOSS_MmuStats stats;
 } MMUInfo;
 
 static MMUInfo *mmuPtr = NULL;
+static int      mmuMode = 0;    /* Mode for the next USLOSS_MmuInit */
+static int      mmuNumTags = USLOSS_MMU_NUM_TAG; /* Tags for the next
+                                                  * USLOSS_MmuInit */
+static int      mmuTlbEntries = 0; /* TLB for the next USLOSS_MmuInit */
+static int      mmuTlbWays = 1;
+static int      mmuTlbFlags = USLOSS_MMU_TLB_LRU;
+static int      mmuLargePages = 0; /* Large page for the next USLOSS_MmuInit */
 
 #ifndef DEBUG
 static int debugging = 0;
@@ -70,7 +136,25 @@ static int debugging = 0;
 static int debugging = 1;
 #endif
 
-#define PageAddr(i)     (mmuPtr->region + ((i) * mmuPageSize))
+#define PageAddr(i)     (mmuPtr->region + ((size_t) (i) * mmuPageSize))
+#define RegionSize()    ((size_t) mmuPtr->numPages * mmuPageSize)
+#define FrameOffset(f)  ((off_t) (f) * mmuFrameStride)
+#define PROT_RW         (PROT_READ|PROT_WRITE)
+
+/*
+ * Bits in a /proc/self/pagemap entry.
+ */
+#define PM_SOFT_DIRTY   (1ULL << 55)
+#define PM_PRESENT      (1ULL << 63)
+
+/*
+ * A page of a particular tag, packed into an int for the reverse maps.
+ */
+#define PageRef(tag, page)      (((tag) * mmuPtr->numPages) + (page))
+#define RefTag(ref)             ((ref) / mmuPtr->numPages)
+#define RefPage(ref)            ((ref) % mmuPtr->numPages)
+#define RefPtr(ref)             (&mmuPtr->pages[RefTag(ref)][RefPage(ref)])
+#define LargeHead(i)            ((i) & ~(mmuPtr->largePages - 1))
 #define PageIndex(addr) (mmuPtr != NULL) ? \
     (((void *) (addr) - mmuPtr->region) / mmuPageSize) : 0;
 
@@ -79,12 +163,181 @@ typedef int Boolean;
 #define FALSE 0
 
 static int      mmuPageSize;
+static int      mmuFrameStride; /* Bytes between frames in the memory file */
 Boolean  mmuInTouch = FALSE;
 sigjmp_buf  mmuTouchBuf;
-static int      nowhere;
+static off_t    nowhere;
 
 static void SetRealProt(int page, int prot);
+static void SetTagProt(int tag, int page, int prot);
+static void *TagPageAddr(int tag, int page);
+static MMUPage *PageTable(int tag);
+static void *Shadow(int tag);
+static void TlbLoad(int page);
+static void TlbEvict(int entry);
+static void TlbRemove(MMUPage *pagePtr);
+static void SetFrameAccess(int frame, int access);
+static int FrameAccess(int frame);
+static void MarkAccess(int frame, int access);
+static void LargeRange(int tag, int *pagePtr, int *countPtr);
+static int SwapRegions(int old, int new);
+static void RevInsert(int tag, int page);
+static void RevRemove(int tag, int page);
 static int SetTag(int tag);
+static int MapProt(int virtProt);
+static int SoftDirtyWorks(int pagemap, int clearRefs);
+static void Harvest(int tag, int page, int count);
+static void HarvestBegin(int tag, int page, int count);
+static void HarvestEnd(void);
+static int MemFile(off_t size, int huge);
+static void *Reserve(size_t size);
+static int HugePageSize(void);
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuSetMode --
+ *
+ *      Selects the USLOSS_MMU_MODE_* flags used by the next
+ *      USLOSS_MmuInit.
+ *
+ * Results:
+ *      MMU return status
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuSetMode(mode)
+    int         mode;           /* USLOSS_MMU_MODE_* flags */
+{
+    check_kernel_mode("USLOSS_MmuSetMode");
+    if (mmuPtr != NULL) {
+        return USLOSS_MMU_ERR_ON;
+    }
+    if ((mode & ~(USLOSS_MMU_MODE_PREBUILT|USLOSS_MMU_MODE_HARVEST|
+                  USLOSS_MMU_MODE_HUGE)) != 0) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    if ((mode & USLOSS_MMU_MODE_HUGE) && 
+        ((mode & USLOSS_MMU_MODE_HARVEST) || (HugePageSize() <= 0))) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    mmuMode = mode;
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuSetNumTags --
+ *
+ *      Sets the number of tags used by the next USLOSS_MmuInit, e.g. one
+ *      per process so that a context switch never has to rebuild a
+ *      tag's mappings. Tags cost nothing until they are used.
+ *
+ * Results:
+ *      MMU return status
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuSetNumTags(numTags)
+    int         numTags;        /* # of tags, USLOSS_MMU_NUM_TAG by default */
+{
+    check_kernel_mode("USLOSS_MmuSetNumTags");
+    if (mmuPtr != NULL) {
+        return USLOSS_MMU_ERR_ON;
+    }
+    if ((numTags < 1) || (numTags > USLOSS_MMU_MAX_TAG)) {
+        return USLOSS_MMU_ERR_TAG;
+    }
+    mmuNumTags = numTags;
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuSetTlb --
+ *
+ *      Configures the TLB used by the next USLOSS_MmuInit. The TLB has
+ *      entries / ways sets and a page can only be loaded into the set
+ *      given by its page number. Flags is one of the USLOSS_MMU_TLB_*
+ *      policies, optionally or'ed with USLOSS_MMU_TLB_MISS_INT. The
+ *      entries are tagged, so switching tags doesn't flush the TLB.
+ *      There is no TLB if entries is 0, which is the default.
+ *
+ * Results:
+ *      MMU return status
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuSetTlb(entries, ways, flags)
+    int         entries;        /* # of TLB entries, or 0 */
+    int         ways;           /* # of entries per set */
+    int         flags;          /* Replacement policy and flags */
+{
+    int         policy = flags & ~USLOSS_MMU_TLB_MISS_INT;
+
+    check_kernel_mode("USLOSS_MmuSetTlb");
+    if (mmuPtr != NULL) {
+        return USLOSS_MMU_ERR_ON;
+    }
+    if ((entries < 0) || (ways < 1) || 
+        ((entries > 0) && ((ways > entries) || (entries % ways != 0)))) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    if ((policy != USLOSS_MMU_TLB_LRU) && (policy != USLOSS_MMU_TLB_FIFO) &&
+        (policy != USLOSS_MMU_TLB_RANDOM)) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    mmuTlbEntries = entries;
+    mmuTlbWays = ways;
+    mmuTlbFlags = flags;
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuSetLargePage --
+ *
+ *      Sets the number of pages in a large page for the next
+ *      USLOSS_MmuInit. It must be a power of two. Large pages can't be
+ *      used if it is 0, which is the default.
+ *
+ * Results:
+ *      MMU return status
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuSetLargePage(pages)
+    int         pages;          /* # of pages in a large page, or 0 */
+{
+    check_kernel_mode("USLOSS_MmuSetLargePage");
+    if (mmuPtr != NULL) {
+        return USLOSS_MMU_ERR_ON;
+    }
+    if ((pages < 0) || (pages == 1) || ((pages & (pages - 1)) != 0)) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    mmuLargePages = pages;
+    return USLOSS_MMU_OK;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -111,14 +364,12 @@ USLOSS_MmuInit(numMaps, numPages, numFrames)
     int         numFrames;      /* # of page frames. */
 {
     int                 fd = -1;
-    FILE                *stream;
     int                 i;
     void                *region = NULL;
-    int                 result;
-    int                 tag;
-    MMUPage             *pagePtr;
     int                 totalPages;
-    char                *buffer;
+    int                 pagemap = -1;
+    int                 clearRefs = -1;
+    int                 softDirty = FALSE;
 
     check_kernel_mode("USLOSS_MmuInit");
     debug("USLOSS_MmuInit: %d pages %d frames\n", numPages, numFrames);
@@ -132,32 +383,70 @@ USLOSS_MmuInit(numMaps, numPages, numFrames)
     if (numFrames < 1) {
         return USLOSS_MMU_ERR_FRAME;
     }
-    if ((numMaps < 1) || (numMaps > (numPages * USLOSS_MMU_NUM_TAG))) {
+    if ((numMaps < 1) || (numMaps > (numPages * mmuNumTags))) {
         return USLOSS_MMU_ERR_MAPS;
     }
-    stream = tmpfile();
-    assert(stream != NULL);
-    fd = fileno(stream);
     /*
-     * Allocate the virtual region, plus a couple of guard pages.
+     * The TLB decides which pages have real access, so it can't be used
+     * with the modes that give pages real access of their own.
+     */
+    if ((mmuTlbEntries > 0) && 
+        (mmuMode & (USLOSS_MMU_MODE_PREBUILT|USLOSS_MMU_MODE_HARVEST))) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    /*
+     * Harvest mode reads the access bits out of the host page tables.
+     * If the host doesn't keep soft-dirty bits writes are still caught
+     * with a fault, but reads never are.
+     */
+    if (mmuMode & USLOSS_MMU_MODE_HARVEST) {
+        pagemap = open("/proc/self/pagemap", O_RDONLY);
+        if (pagemap == -1) {
+            return USLOSS_MMU_ERR_MODE;
+        }
+        clearRefs = open("/proc/self/clear_refs", O_WRONLY);
+        softDirty = (clearRefs != -1) && SoftDirtyWorks(pagemap, clearRefs);
+        debug("USLOSS_MmuInit: harvest mode, soft-dirty %d\n", softDirty);
+    }
+    /*
+     * In harvest mode the frames are spaced out in the file so that
+     * neighbouring pages never share a host mapping. Otherwise the host
+     * maps in the neighbours of a page when it faults the page in, and
+     * they look referenced.
+     */
+    mmuFrameStride = mmuPageSize;
+    if (mmuMode & USLOSS_MMU_MODE_HARVEST) {
+        mmuFrameStride = 2 * mmuPageSize;
+    }
+    /*
+     * Physical memory is a file that reads as zeros until it is written,
+     * so it doesn't have to be filled in. Unmapped pages are mapped to
+     * the extra page at the end.
+     */
+    nowhere = FrameOffset(numFrames);
+    fd = MemFile(nowhere + mmuPageSize, mmuMode & USLOSS_MMU_MODE_HUGE);
+    if (fd == -1) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    if (mmuMode & USLOSS_MMU_MODE_HUGE) {
+        /*
+         * Claim the huge pages now instead of dying of a SIGBUS when 
+         * the pool runs dry.
+         */
+        if (fallocate(fd, 0, 0, nowhere) != 0) {
+            (void) close(fd);
+            return USLOSS_MMU_ERR_MODE;
+        }
+    }
+    debug("USLOSS_MmuInit: nowhere 0x%lx\n", (long) nowhere);
+    /*
+     * Reserve the virtual region, plus a couple of guard pages.
      */
     totalPages = numPages+2;
-    result = posix_memalign(&region, mmuPageSize, totalPages * mmuPageSize);
-    assert(result == 0);
-    memset(region, '7', totalPages * mmuPageSize);
-    assert(USLOSS_MmuTouch(region) == TRUE);
-    buffer = malloc(mmuPageSize);
-    memset(buffer, '8', mmuPageSize);
-    for (i = 0; i < numFrames + 1; i++) {
-        write(fd, buffer, mmuPageSize);
-    }
-    free(buffer);
-    nowhere = numFrames * mmuPageSize;
-    debug("USLOSS_MmuInit: totalPages %d, nowhere 0x%x, file 0x%x\n",
-        totalPages, nowhere, lseek(fd, 0, SEEK_CUR));
-    result = mprotect(region, totalPages * mmuPageSize, PROT_NONE);
-    assert(result == 0);
+    region = Reserve((size_t) totalPages * mmuPageSize);
+#ifdef MMU_VALIDATE
     assert(USLOSS_MmuTouch(region) == FALSE);
+#endif
     region += mmuPageSize;
 
     mmuPtr = (MMUInfo *) malloc(sizeof(MMUInfo));
@@ -169,21 +458,39 @@ USLOSS_MmuInit(numMaps, numPages, numFrames)
     mmuPtr->region = region;
     mmuPtr->cause = 0;
     mmuPtr->tag = 0;
+    mmuPtr->mode = mmuMode;
+    mmuPtr->numTags = mmuNumTags;
+    mmuPtr->pagemap = pagemap;
+    mmuPtr->clearRefs = clearRefs;
+    mmuPtr->softDirty = softDirty;
+    mmuPtr->entries = (uint64_t *) malloc(numPages * sizeof(uint64_t));
     /*
-     * Allocate the page and frame information. Also unmap the region.
+     * The page tables and shadow regions are allocated by PageTable
+     * and Shadow when a tag is first used.
      */
+    mmuPtr->pages = (MMUPage **) calloc(mmuNumTags, sizeof(MMUPage *));
+    mmuPtr->shadows = (void **) calloc(mmuNumTags + 1, sizeof(void *));
     mmuPtr->frames = (MMUFrame *) malloc(numFrames * sizeof(MMUFrame));
-    for (tag = 0; tag < USLOSS_MMU_NUM_TAG; tag++) {
-        mmuPtr->pages[tag] = (MMUPage *) malloc(numPages * sizeof(MMUPage));
-        for (i = 0; i < numPages; i++) {
-            pagePtr = &mmuPtr->pages[tag][i];
-            pagePtr->frame = -1;
-            pagePtr->realProt = 0;
-            pagePtr->virtProt = 0;
-        }
-    }           
+    mmuPtr->tlb = NULL;
+    mmuPtr->tlbEntries = mmuTlbEntries;
+    mmuPtr->tlbWays = mmuTlbWays;
+    mmuPtr->tlbFlags = mmuTlbFlags;
+    mmuPtr->largePages = mmuLargePages;
+    mmuPtr->tlbClock = 0;
+    mmuPtr->tlbSeed = 1;
+    if (mmuTlbEntries > 0) {
+        mmuPtr->tlb = (MMUTlbEntry *) malloc(mmuTlbEntries * 
+                                             sizeof(MMUTlbEntry));
+        for (i = 0; i < mmuTlbEntries; i++) {
+            mmuPtr->tlb[i].ref = -1;
+            mmuPtr->tlb[i].stamp = 0;
+        }
+    }
+    memset(&mmuPtr->stats, 0, sizeof(mmuPtr->stats));
     for (i = 0; i < numFrames; i++) {
         mmuPtr->frames[i].access = 0;
+        mmuPtr->frames[i].head = -1;
+        mmuPtr->frames[i].large = 0;
     }
     return USLOSS_MMU_OK;
 }
@@ -234,25 +541,45 @@ USLOSS_MmuRegion(numPagesPtr)
 int
 USLOSS_MmuDone()
 {
-    int         result;
+    void        *addr;
     int         i;
 
     check_kernel_mode("USLOSS_MmuDone");
     if (mmuPtr == NULL) {
         return USLOSS_MMU_ERR_OFF;
     }
-    debug("USLOSS_MmuDone: unmapping 0x%p, %d bytes\n", mmuPtr->region,
-        mmuPtr->numPages * mmuPageSize);
-    result = mprotect(mmuPtr->region, mmuPtr->numPages * mmuPageSize,
-                PROT_NONE);
-    if (result != 0) {
-        perror("USLOSS_MmuDone: mprotect");
+    debug("USLOSS_MmuDone: unmapping 0x%p, %ld bytes\n", mmuPtr->region,
+        (long) RegionSize());
+    /*
+     * Drop the frames but keep the region reserved, so stray accesses
+     * still fault.
+     */
+    addr = mmap(mmuPtr->region, RegionSize(), PROT_NONE, 
+                MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED, -1, 0);
+    if (addr == MAP_FAILED) {
+        perror("USLOSS_MmuDone: mmap");
         abort();
     }
-    for (i = 0; i < USLOSS_MMU_NUM_TAG; i++) {
+    (void) close(mmuPtr->fd);
+    for (i = 0; i < mmuPtr->numTags; i++) {
         free((char *) mmuPtr->pages[i]);
     }
+    for (i = 0; i <= mmuPtr->numTags; i++) {
+        if (mmuPtr->shadows[i] != NULL) {
+            (void) munmap(mmuPtr->shadows[i], RegionSize());
+        }
+    }
+    free((char *) mmuPtr->pages);
+    free((char *) mmuPtr->shadows);
+    if (mmuPtr->pagemap != -1) {
+        (void) close(mmuPtr->pagemap);
+    }
+    if (mmuPtr->clearRefs != -1) {
+        (void) close(mmuPtr->clearRefs);
+    }
+    free((char *) mmuPtr->entries);
     free((char *) mmuPtr->frames);
+    free((char *) mmuPtr->tlb);
     free((char *) mmuPtr);
     mmuPtr = NULL;
     return USLOSS_MMU_OK;
@@ -280,6 +607,7 @@ USLOSS_MmuMap(tag, page, frame, protection)
     int         protection;     /* Protection for the frame. */
 {
     void        *addr;
+    void        *pageAddr;
     MMUPage     *pagePtr;
 
     check_kernel_mode("USLOSS_MmuMap");
@@ -298,30 +626,43 @@ USLOSS_MmuMap(tag, page, frame, protection)
     if ((protection & (~(USLOSS_MMU_PROT_RW))) != 0) {
         return USLOSS_MMU_ERR_PROT;
     }
-    if ((tag < 0) || (tag >= USLOSS_MMU_NUM_TAG)) {
+    if ((tag < 0) || (tag >= mmuPtr->numTags)) {
         return USLOSS_MMU_ERR_TAG;
     }
-    pagePtr = &mmuPtr->pages[tag][page];
+    pagePtr = &PageTable(tag)[page];
     if (pagePtr->frame != -1) {
         return USLOSS_MMU_ERR_REMAP;
     }
-    if (tag == mmuPtr->tag) {
-        debug("USLOSS_MmuMap: mmap 0x%p -> 0x%x\n", PageAddr(page),
-           frame * mmuPageSize);
-        (void) msync(PageAddr(page), mmuPageSize, MS_SYNC);
-        (void) munmap(PageAddr(page), mmuPageSize);
-        addr = mmap(PageAddr(page), mmuPageSize, PROT_NONE, 
-                    MAP_SHARED|MAP_FIXED, mmuPtr->fd, frame * mmuPageSize);
+    /*
+     * A page that would get no real access is left to the fault on its
+     * first access to map in.
+     */
+    pageAddr = TagPageAddr(tag, page);
+    if ((pageAddr != NULL) && (MapProt(protection) == PROT_NONE)) {
+        pageAddr = NULL;
+    }
+    if (pageAddr != NULL) {
+        debug("USLOSS_MmuMap: mmap 0x%p -> 0x%x\n", pageAddr,
+           FrameOffset(frame));
+        HarvestBegin(tag, page, 1);
+        /*
+         * MAP_FIXED replaces the old mapping in one step. The memory file
+         * never has to reach the disk, so there is nothing to sync.
+         */
+        addr = mmap(pageAddr, mmuPageSize, MapProt(protection), 
+                    MAP_SHARED|MAP_FIXED, mmuPtr->fd, FrameOffset(frame));
         assert(addr != MAP_FAILED);
-        assert(addr == PageAddr(page));
+        assert(addr == pageAddr);
+        HarvestEnd();
     }
     debug("USLOSS_MmuMap: mapping page %d (0x%p) -> %d\n", page, PageAddr(page),
         frame);
     mmuPtr->numMaps++;
     assert(mmuPtr->numMaps <= mmuPtr->maxMaps);
     pagePtr->frame = frame;
-    pagePtr->realProt = PROT_NONE;
+    pagePtr->realProt = (pageAddr != NULL) ? MapProt(protection) : PROT_NONE;
     pagePtr->virtProt = protection;
+    RevInsert(tag, page);
     return USLOSS_MMU_OK;
 }
 /*
@@ -329,7 +670,8 @@ USLOSS_MmuMap(tag, page, frame, protection)
  *
  * USLOSS_MmuUnmap --
  *
- *      Unmaps a page. The page must already be mapped.
+ *      Unmaps a page. The page must already be mapped. If it is part of
+ *      a large page the whole large page is unmapped.
  *
  * Results:
  *      MMU return status.
@@ -345,6 +687,7 @@ USLOSS_MmuUnmap(tag, page)
     int         page;   /* Page to unmap. */
 {
     MMUPage     *pagePtr;
+    void        *pageAddr;
 
     check_kernel_mode("USLOSS_MmuUnmap");
     if (mmuPtr == NULL) {
@@ -353,26 +696,37 @@ USLOSS_MmuUnmap(tag, page)
     if ((page < 0) || (page >= mmuPtr->numPages)) {
         return USLOSS_MMU_ERR_PAGE;
     }
-    if ((tag < 0) || (tag >= USLOSS_MMU_NUM_TAG)) {
+    if ((tag < 0) || (tag >= mmuPtr->numTags)) {
         return USLOSS_MMU_ERR_TAG;
     }
+    if (mmuPtr->pages[tag] == NULL) {
+        return USLOSS_MMU_ERR_NOMAP;
+    }
     pagePtr = &mmuPtr->pages[tag][page];
     if (pagePtr->frame == -1) {
         return USLOSS_MMU_ERR_NOMAP;
     }
+    if (pagePtr->large) {
+        return USLOSS_MmuUnmapRange(tag, page, 1);
+    }
     debug("USLOSS_MmuUnmap: unmapping page %d (0x%p)\n", page, PageAddr(page));
-    if (tag == mmuPtr->tag) {
+    pageAddr = TagPageAddr(tag, page);
+    if (pageAddr != NULL) {
         void *addr;
         debug("USLOSS_MmuUnmap: frame %d, virtProt %d, realProt %d\n", 
             pagePtr->frame, pagePtr->virtProt, pagePtr->realProt);
-        (void) msync(PageAddr(page), mmuPageSize, MS_SYNC);
-        (void) munmap(PageAddr(page), mmuPageSize);
-        addr = mmap(PageAddr(page), mmuPageSize, PROT_NONE, 
+        HarvestBegin(tag, page, 1);
+        addr = mmap(pageAddr, mmuPageSize, PROT_NONE, 
                     MAP_SHARED|MAP_FIXED, mmuPtr->fd, nowhere);
         assert(addr != MAP_FAILED);
-        assert(USLOSS_MmuTouch(PageAddr(page)) == FALSE);
+        HarvestEnd();
+#ifdef MMU_VALIDATE
+        assert(USLOSS_MmuTouch(pageAddr) == FALSE);
+#endif
     }
     mmuPtr->numMaps--;
+    RevRemove(tag, page);
+    TlbRemove(pagePtr);
     pagePtr->frame = -1;
     pagePtr->realProt = PROT_NONE;
     pagePtr->virtProt = 0;
@@ -381,356 +735,1651 @@ USLOSS_MmuUnmap(tag, page)
 /*
  *----------------------------------------------------------------------
  *
- * USLOSS_MmuGetMap --
+ * USLOSS_MmuMapRange --
  *
- *      Returns the mapping for the given page under the given tag.
+ *      Maps count consecutive pages starting at page to consecutive
+ *      frames starting at frame. Nothing is mapped unless the whole
+ *      range can be. Outside of harvest mode the range is mapped with a
+ *      single host call and no real access, so the first accesses only
+ *      raise the protection. In harvest mode the frames are spaced out
+ *      in the memory file and every page gets a host mapping of its own.
  *
  * Results:
  *      MMU return status.
  *
  * Side effects:
- *      None.
+ *      Memory is mapped.
  *
  *----------------------------------------------------------------------
  */
 int
-USLOSS_MmuGetMap(tag, page, framePtr, protPtr)
-    int         tag;            /* tag for mapping */
-    int         page;           /* Page for mapping */
-    int         *framePtr;      /* Place to store frame */
-    int         *protPtr;       /* Place to store protection */
+USLOSS_MmuMapRange(tag, page, frame, count, protection)
+    int         tag;            /* tag associated with map. */
+    int         page;           /* First page to be mapped. */
+    int         frame;          /* First frame to map the pages into. */
+    int         count;          /* # of pages to map. */
+    int         protection;     /* Protection for the frames. */
 {
+    void        *addr;
+    void        *pageAddr;
     MMUPage     *pagePtr;
+    int         prot;
+    int         i;
 
-#ifdef NOTDEF
-    check_kernel_mode("USLOSS_MmuGetMap");
-#endif
+    check_kernel_mode("USLOSS_MmuMapRange");
     if (mmuPtr == NULL) {
         return USLOSS_MMU_ERR_OFF;
     }
-    if ((page < 0) || (page >= mmuPtr->numPages)) {
+    if ((count < 1) || (page < 0) || (page + count > mmuPtr->numPages)) {
         return USLOSS_MMU_ERR_PAGE;
     }
-    if ((tag < 0) || (tag >= USLOSS_MMU_NUM_TAG)) {
+    if ((frame < 0) || (frame + count > mmuPtr->numFrames)) {
+        return USLOSS_MMU_ERR_FRAME;
+    }
+    if (mmuPtr->numMaps + count > mmuPtr->maxMaps) {
+        return USLOSS_MMU_ERR_MAPS;
+    }
+    if ((protection & (~(USLOSS_MMU_PROT_RW))) != 0) {
+        return USLOSS_MMU_ERR_PROT;
+    }
+    if ((tag < 0) || (tag >= mmuPtr->numTags)) {
         return USLOSS_MMU_ERR_TAG;
     }
-    pagePtr = &mmuPtr->pages[tag][page];
-    if (pagePtr->frame == -1) {
-        return USLOSS_MMU_ERR_NOMAP;
+    pagePtr = PageTable(tag);
+    for (i = 0; i < count; i++) {
+        if (pagePtr[page + i].frame != -1) {
+            return USLOSS_MMU_ERR_REMAP;
+        }
+    }
+    pageAddr = TagPageAddr(tag, page);
+    prot = (pageAddr != NULL) ? MapProt(protection) : PROT_NONE;
+    if ((mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) == 0) {
+        if (pageAddr != NULL) {
+            debug("USLOSS_MmuMapRange: mmap 0x%p (%d pages) -> 0x%x\n", 
+               pageAddr, count, FrameOffset(frame));
+            addr = mmap(pageAddr, count * mmuPageSize, PROT_NONE,
+                        MAP_SHARED|MAP_FIXED, mmuPtr->fd, FrameOffset(frame));
+            assert(addr == pageAddr);
+        }
+    } else if (prot != PROT_NONE) {
+        debug("USLOSS_MmuMapRange: mmap 0x%p (%d pages) -> 0x%x\n", pageAddr,
+           count, FrameOffset(frame));
+        HarvestBegin(tag, page, count);
+        for (i = 0; i < count; i++) {
+            addr = mmap(pageAddr + (i * mmuPageSize), mmuPageSize, prot,
+                        MAP_SHARED|MAP_FIXED, mmuPtr->fd, 
+                        FrameOffset(frame + i));
+            assert(addr == pageAddr + (i * mmuPageSize));
+        }
+        HarvestEnd();
+    }
+    mmuPtr->numMaps += count;
+    for (i = 0; i < count; i++) {
+        pagePtr = &mmuPtr->pages[tag][page + i];
+        pagePtr->frame = frame + i;
+        pagePtr->realProt = prot;
+        pagePtr->virtProt = protection;
+        RevInsert(tag, page + i);
     }
-    *framePtr = pagePtr->frame;
-    *protPtr = pagePtr->virtProt;
     return USLOSS_MMU_OK;
 }
 
 /*
  *----------------------------------------------------------------------
  *
- * USLOSS_MmuGetCause --
+ * USLOSS_MmuMapLarge --
  *
- *      Returns information about the last page fault or access violation.
+ *      Maps a large page of USLOSS_MmuSetLargePage pages starting at page
+ *      to the frames starting at frame. Both must be multiples of the
+ *      large page size. The large page is mapped in by the fault on its
+ *      first access and shares one set of access bits.
  *
  * Results:
- *      0, USLOSS_MMU_FAULT, or USLOSS_MMU_ACCESS
+ *      MMU return status.
  *
  * Side effects:
- *      None.
+ *      Memory is mapped.
  *
  *----------------------------------------------------------------------
  */
 int
-USLOSS_MmuGetCause(void)
+USLOSS_MmuMapLarge(tag, page, frame, protection)
+    int         tag;            /* tag associated with map. */
+    int         page;           /* First page of the large page. */
+    int         frame;          /* First frame of the large page. */
+    int         protection;     /* Protection for the frames. */
 {
-    int         cause = 0;
+    MMUPage     *pagePtr;
+    int         status;
+    int         i;
 
-    check_kernel_mode("USLOSS_MmuGetCause");
-    if (mmuPtr != NULL) {
-        cause = mmuPtr->cause;
+    check_kernel_mode("USLOSS_MmuMapLarge");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
     }
-    return cause;
+    /*
+     * Harvest mode and the TLB both give each page real access of its
+     * own.
+     */
+    if ((mmuPtr->largePages == 0) || (mmuPtr->tlb != NULL) ||
+        (mmuPtr->mode & USLOSS_MMU_MODE_HARVEST)) {
+        return USLOSS_MMU_ERR_MODE;
+    }
+    if (LargeHead(page) != page) {
+        return USLOSS_MMU_ERR_PAGE;
+    }
+    if (LargeHead(frame) != frame) {
+        return USLOSS_MMU_ERR_FRAME;
+    }
+    status = USLOSS_MmuMapRange(tag, page, frame, mmuPtr->largePages, 
+                protection);
+    if (status != USLOSS_MMU_OK) {
+        return status;
+    }
+    for (i = 0; i < mmuPtr->largePages; i++) {
+        pagePtr = &mmuPtr->pages[tag][page + i];
+        pagePtr->large = TRUE;
+        mmuPtr->frames[pagePtr->frame].large++;
+    }
+    return USLOSS_MMU_OK;
 }
-        
 
 /*
  *----------------------------------------------------------------------
  *
- * USLOSS_MmuSetAccess --
+ * USLOSS_MmuUnmapRange --
  *
- *      Sets the frame access bits. Sets the reference bit if 
- *      USLOSS_MMU_REF is set and sets the dirty bit if USLOSS_MMU_DIRTY is set;
- *      otherwise the bits are cleared.
+ *      Unmaps count consecutive pages starting at page. All of them must
+ *      be mapped. A large page at either end of the range is unmapped
+ *      as a whole. The range is unmapped with a single host call.
  *
  * Results:
  *      MMU return status.
  *
  * Side effects:
- *      The frame access bits are changed.
+ *      Memory is unmapped.
  *
  *----------------------------------------------------------------------
  */
 int
-USLOSS_MmuSetAccess(frame, access)
-    int         frame;          /* Frame whose bits are to be modified. */
-    int         access;         /* Access bits to be cleared. */
+USLOSS_MmuUnmapRange(tag, page, count)
+    int         tag;            /* tag associated with pages. */
+    int         page;           /* First page to unmap. */
+    int         count;          /* # of pages to unmap. */
 {
+    void        *addr;
+    void        *pageAddr;
+    MMUPage     *pagePtr;
     int         i;
-    int         prot;
-    int         old;
 
-    check_kernel_mode("USLOSS_MmuSetAccess");
-    debug("USLOSS_MmuSetAccess: frame %d access %d\n", frame, access);
+    check_kernel_mode("USLOSS_MmuUnmapRange");
     if (mmuPtr == NULL) {
         return USLOSS_MMU_ERR_OFF;
     }
-    if ((frame < 0) || (frame >= mmuPtr->numFrames)) {
-        return USLOSS_MMU_ERR_FRAME;
+    if ((count < 1) || (page < 0) || (page + count > mmuPtr->numPages)) {
+        return USLOSS_MMU_ERR_PAGE;
     }
-    if ((access & (~(USLOSS_MMU_REF|USLOSS_MMU_DIRTY))) != 0) {
-        return USLOSS_MMU_ERR_ACC;
+    if ((tag < 0) || (tag >= mmuPtr->numTags)) {
+        return USLOSS_MMU_ERR_TAG;
     }
-    old = mmuPtr->frames[frame].access;
-    mmuPtr->frames[frame].access = access;
-    debug("USLOSS_MmuSetAccess: frame %d was %d is %d\n", frame,
-        old, mmuPtr->frames[frame].access);
-    /*
-     * Now run through the page table and protect all pages mapped
-     * to this frame so the access bits will be set properly.
-     */
-    if ((access & USLOSS_MMU_REF) == 0) {
-        prot = PROT_NONE;
-    } else if ((access & USLOSS_MMU_DIRTY) == 0) {
-        prot = PROT_READ;
-    } else {
-        return USLOSS_MMU_OK;
+    if (mmuPtr->pages[tag] == NULL) {
+        return USLOSS_MMU_ERR_NOMAP;
     }
-    for (i = 0; i < mmuPtr->numPages; i++) {
-        if (mmuPtr->pages[mmuPtr->tag][i].frame == frame) {
-            SetRealProt(i, prot);
+    LargeRange(tag, &page, &count);
+    for (i = 0; i < count; i++) {
+        if (mmuPtr->pages[tag][page + i].frame == -1) {
+            return USLOSS_MMU_ERR_NOMAP;
+        }
+    }
+    pageAddr = TagPageAddr(tag, page);
+    if (pageAddr != NULL) {
+        debug("USLOSS_MmuUnmapRange: unmapping 0x%p (%d pages)\n", pageAddr,
+            count);
+        HarvestBegin(tag, page, count);
+        addr = mmap(pageAddr, count * mmuPageSize, PROT_NONE, 
+                    MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+        assert(addr == pageAddr);
+        HarvestEnd();
+    }
+    mmuPtr->numMaps -= count;
+    for (i = 0; i < count; i++) {
+        pagePtr = &mmuPtr->pages[tag][page + i];
+        RevRemove(tag, page + i);
+        TlbRemove(pagePtr);
+        if (pagePtr->large) {
+            mmuPtr->frames[pagePtr->frame].large--;
+            pagePtr->large = FALSE;
         }
+        pagePtr->frame = -1;
+        pagePtr->realProt = PROT_NONE;
+        pagePtr->virtProt = 0;
     }
     return USLOSS_MMU_OK;
 }
+
 /*
  *----------------------------------------------------------------------
  *
- * USLOSS_MmuGetAccess --
+ * USLOSS_MmuProtectRange --
  *
- *              Returns the access bits for the given frame.
+ *      Changes the protection of count consecutive mapped pages starting
+ *      at page, widened to cover any large page at either end. Real
+ *      protections are only ever lowered here (raising them is left to
+ *      the access-bit faults) unless the MMU is in harvest mode, and each
+ *      run of pages that needs changing takes a single mprotect.
  *
  * Results:
  *      MMU return status.
  *
  * Side effects:
- *      None.
+ *      Page protections are changed.
  *
  *----------------------------------------------------------------------
  */
 int
-USLOSS_MmuGetAccess(frame, accessPtr)
-    int         frame;          /* Frame whose access bits are wanted.*/
-    int         *accessPtr;     /* Pointer to the access bits. */
+USLOSS_MmuProtectRange(tag, page, count, protection)
+    int         tag;            /* tag associated with pages. */
+    int         page;           /* First page to protect. */
+    int         count;          /* # of pages to protect. */
+    int         protection;     /* New protection for the pages. */
 {
-        
-    check_kernel_mode("USLOSS_MmuGetAccess");
+    MMUPage     *pagePtr;
+    void        *pageAddr;
+    int         i;
+    int         first;
+    int         limit;
+    int         want;
+    int         runProt = PROT_NONE;
+    int         result;
+
+    check_kernel_mode("USLOSS_MmuProtectRange");
     if (mmuPtr == NULL) {
         return USLOSS_MMU_ERR_OFF;
     }
-    if ((frame < 0) || (frame >= mmuPtr->numFrames)) {
+    if ((count < 1) || (page < 0) || (page + count > mmuPtr->numPages)) {
+        return USLOSS_MMU_ERR_PAGE;
+    }
+    if ((protection & (~(USLOSS_MMU_PROT_RW))) != 0) {
+        return USLOSS_MMU_ERR_PROT;
+    }
+    if ((tag < 0) || (tag >= mmuPtr->numTags)) {
+        return USLOSS_MMU_ERR_TAG;
+    }
+    if (mmuPtr->pages[tag] == NULL) {
+        return USLOSS_MMU_ERR_NOMAP;
+    }
+    LargeRange(tag, &page, &count);
+    for (i = 0; i < count; i++) {
+        if (mmuPtr->pages[tag][page + i].frame == -1) {
+            return USLOSS_MMU_ERR_NOMAP;
+        }
+    }
+    /*
+     * The most the real protection may be for the new protection.
+     */
+    if (protection == USLOSS_MMU_PROT_RW) {
+        limit = PROT_READ|PROT_WRITE;
+    } else if (protection == USLOSS_MMU_PROT_READ) {
+        limit = PROT_READ;
+    } else {
+        limit = PROT_NONE;
+    }
+    pageAddr = TagPageAddr(tag, page);
+    first = -1;
+    for (i = 0; i <= count; i++) {
+        pagePtr = (i < count) ? &mmuPtr->pages[tag][page + i] : NULL;
+        want = -1;
+        if ((pagePtr != NULL) && 
+            ((mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) == 0)) {
+            if ((pagePtr->realProt & ~limit) != 0) {
+                want = limit;
+            }
+        } else if ((pagePtr != NULL) && (pageAddr != NULL) &&
+                   (pagePtr->realProt != PROT_NONE)) {
+            /*
+             * In harvest mode the real protection follows the new one,
+             * but a page that was already written keeps write access.
+             * Pages without real access are left for the fault on their
+             * next access to map in.
+             */
+            want = MapProt(protection);
+            if ((pagePtr->realProt == PROT_RW) && (limit == PROT_RW)) {
+                want = PROT_RW;
+            }
+            if (want == pagePtr->realProt) {
+                want = -1;
+            }
+        }
+        if ((first != -1) && (want != runProt)) {
+            if (pageAddr != NULL) {
+                result = mprotect(pageAddr + (first * mmuPageSize), 
+                            (i - first) * mmuPageSize, runProt);
+                assert(result == 0);
+            }
+            first = -1;
+        }
+        if (want != -1) {
+            pagePtr->realProt = want;
+            if (first == -1) {
+                first = i;
+                runProt = want;
+            }
+        }
+        if (pagePtr != NULL) {
+            pagePtr->virtProt = protection;
+        }
+    }
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuGetMap --
+ *
+ *      Returns the mapping for the given page under the given tag.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuGetMap(tag, page, framePtr, protPtr)
+    int         tag;            /* tag for mapping */
+    int         page;           /* Page for mapping */
+    int         *framePtr;      /* Place to store frame */
+    int         *protPtr;       /* Place to store protection */
+{
+    MMUPage     *pagePtr;
+
+#ifdef NOTDEF
+    check_kernel_mode("USLOSS_MmuGetMap");
+#endif
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((page < 0) || (page >= mmuPtr->numPages)) {
+        return USLOSS_MMU_ERR_PAGE;
+    }
+    if ((tag < 0) || (tag >= mmuPtr->numTags)) {
+        return USLOSS_MMU_ERR_TAG;
+    }
+    if (mmuPtr->pages[tag] == NULL) {
+        return USLOSS_MMU_ERR_NOMAP;
+    }
+    pagePtr = &mmuPtr->pages[tag][page];
+    if (pagePtr->frame == -1) {
+        return USLOSS_MMU_ERR_NOMAP;
+    }
+    *framePtr = pagePtr->frame;
+    *protPtr = pagePtr->virtProt;
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuGetCause --
+ *
+ *      Returns information about the last page fault or access violation.
+ *
+ * Results:
+ *      0, USLOSS_MMU_FAULT, or USLOSS_MMU_ACCESS
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuGetCause(void)
+{
+    int         cause = 0;
+
+    check_kernel_mode("USLOSS_MmuGetCause");
+    if (mmuPtr != NULL) {
+        cause = mmuPtr->cause;
+    }
+    return cause;
+}
+        
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuSetAccess --
+ *
+ *      Sets the frame access bits. Sets the reference bit if 
+ *      USLOSS_MMU_REF is set and sets the dirty bit if USLOSS_MMU_DIRTY is set;
+ *      otherwise the bits are cleared.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      The frame access bits are changed.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuSetAccess(frame, access)
+    int         frame;          /* Frame whose bits are to be modified. */
+    int         access;         /* Access bits to be cleared. */
+{
+    int         first;
+    int         i;
+
+    check_kernel_mode("USLOSS_MmuSetAccess");
+    debug("USLOSS_MmuSetAccess: frame %d access %d\n", frame, access);
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((frame < 0) || (frame >= mmuPtr->numFrames)) {
+        return USLOSS_MMU_ERR_FRAME;
+    }
+    if ((access & (~(USLOSS_MMU_REF|USLOSS_MMU_DIRTY))) != 0) {
+        return USLOSS_MMU_ERR_ACC;
+    }
+    /*
+     * A large page has one set of access bits for all of its frames.
+     */
+    if (mmuPtr->frames[frame].large > 0) {
+        first = frame & ~(mmuPtr->largePages - 1);
+        for (i = first; i < first + mmuPtr->largePages; i++) {
+            SetFrameAccess(i, access);
+        }
+    } else {
+        SetFrameAccess(frame, access);
+    }
+    return USLOSS_MMU_OK;
+}
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetFrameAccess
+ *
+ *      Sets the access bits of a single frame. See USLOSS_MmuSetAccess.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The frame access bits are changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SetFrameAccess(frame, access)
+    int         frame;          /* Frame whose bits are to be modified. */
+    int         access;         /* New access bits. */
+{
+    int         prot;
+    int         old;
+    int         tag;
+    int         ref;
+    int         next;
+    void        *pageAddr;
+    int         result;
+
+    old = mmuPtr->frames[frame].access;
+    mmuPtr->frames[frame].access = access;
+    debug("SetFrameAccess: frame %d was %d is %d\n", frame,
+        old, mmuPtr->frames[frame].access);
+    if (mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) {
+        /*
+         * Throw away the host page table entries of the frame's pages so
+         * that the next harvest only sees new accesses. The contents stay
+         * in the memory file. Without soft-dirty bits the pages also have
+         * to be write-protected again to catch the next write.
+         */
+        if (access == (USLOSS_MMU_REF|USLOSS_MMU_DIRTY)) {
+            return;
+        }
+        for (ref = mmuPtr->frames[frame].head; ref != -1; 
+             ref = RefPtr(ref)->next) {
+            pageAddr = TagPageAddr(RefTag(ref), RefPage(ref));
+            if (pageAddr == NULL) {
+                continue;
+            }
+            result = madvise(pageAddr, mmuPageSize, MADV_DONTNEED);
+            assert(result == 0);
+            if (((access & USLOSS_MMU_DIRTY) == 0) && !mmuPtr->softDirty &&
+                (RefPtr(ref)->realProt == PROT_RW)) {
+                result = mprotect(pageAddr, mmuPageSize, PROT_READ);
+                assert(result == 0);
+                RefPtr(ref)->realProt = PROT_READ;
+            }
+        }
+        return;
+    }
+    /*
+     * Now run through the page table and protect all pages mapped
+     * to this frame so the access bits will be set properly.
+     */
+    if ((access & USLOSS_MMU_REF) == 0) {
+        prot = PROT_NONE;
+    } else if ((access & USLOSS_MMU_DIRTY) == 0) {
+        prot = PROT_READ;
+    } else {
+        return;
+    }
+#ifdef MMU_VALIDATE
+    {
+        int     count = 0;
+        int     i;
+
+        for (ref = mmuPtr->frames[frame].head; ref != -1; 
+             ref = RefPtr(ref)->next) {
+            assert(RefPtr(ref)->frame == frame);
+            count--;
+        }
+        for (tag = 0; tag < mmuPtr->numTags; tag++) {
+            for (i = 0; (mmuPtr->pages[tag] != NULL) && 
+                        (i < mmuPtr->numPages); i++) {
+                if (mmuPtr->pages[tag][i].frame == frame) {
+                    count++;
+                }
+            }
+        }
+        assert(count == 0);
+    }
+#endif
+    /*
+     * Pages of the other tags keep their host mappings in prebuilt mode,
+     * so they have to be protected too. Otherwise they are protected
+     * when their tag becomes current. Pages that aren't in the TLB have
+     * no real access to take away. The pages of a large page are all
+     * protected at once, so the rest of them are skipped.
+     */
+    for (ref = mmuPtr->frames[frame].head; ref != -1; ref = next) {
+        next = RefPtr(ref)->next;
+        tag = RefTag(ref);
+        if (RefPtr(ref)->realProt == prot) {
+            continue;
+        }
+        if ((tag == mmuPtr->tag) && 
+            ((mmuPtr->tlb == NULL) || (RefPtr(ref)->tlb != -1))) {
+            SetRealProt(RefPage(ref), prot);
+        } else if (mmuPtr->mode & USLOSS_MMU_MODE_PREBUILT) {
+            SetTagProt(tag, RefPage(ref), prot);
+        }
+    }
+}
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuGetAccess --
+ *
+ *              Returns the access bits for the given frame.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuGetAccess(frame, accessPtr)
+    int         frame;          /* Frame whose access bits are wanted.*/
+    int         *accessPtr;     /* Pointer to the access bits. */
+{
+    int         ref;
+        
+    check_kernel_mode("USLOSS_MmuGetAccess");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((frame < 0) || (frame >= mmuPtr->numFrames)) {
+        return USLOSS_MMU_ERR_FRAME;
+    }
+    if (mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) {
+        for (ref = mmuPtr->frames[frame].head; ref != -1; 
+             ref = RefPtr(ref)->next) {
+            Harvest(RefTag(ref), RefPage(ref), 1);
+        }
+    }
+    *accessPtr = FrameAccess(frame);
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuHarvestAccess --
+ *
+ *      Returns the access bits of many frames at once. If frames is NULL
+ *      the bits of frames 0 through count - 1 are returned. In harvest
+ *      mode the whole vm region is sampled with a single host call.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuHarvestAccess(frames, bits, count)
+    int         *frames;        /* Frames whose bits are wanted, or NULL */
+    int         *bits;          /* Place to store the access bits */
+    int         count;          /* # of frames */
+{
+    int         i;
+    int         frame;
+
+    check_kernel_mode("USLOSS_MmuHarvestAccess");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((count < 0) || ((frames == NULL) && (count > mmuPtr->numFrames))) {
         return USLOSS_MMU_ERR_FRAME;
     }
-    *accessPtr = mmuPtr->frames[frame].access;
+    for (i = 0; (frames != NULL) && (i < count); i++) {
+        if ((frames[i] < 0) || (frames[i] >= mmuPtr->numFrames)) {
+            return USLOSS_MMU_ERR_FRAME;
+        }
+    }
+    if (mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) {
+        Harvest(mmuPtr->tag, 0, mmuPtr->numPages);
+    }
+    for (i = 0; i < count; i++) {
+        frame = (frames != NULL) ? frames[i] : i;
+        bits[i] = FrameAccess(frame);
+    }
     return USLOSS_MMU_OK;
 }
-#define PROTS(real, virt) (((real) << 16) | (virt))
-#define PROT_RW (PROT_READ|PROT_WRITE)
 
 /*
  *----------------------------------------------------------------------
  *
- * USLOSS_MmuHandler --
+ * USLOSS_MmuReadFrame --
+ *
+ *      Copies the contents of a frame into a page-sized buffer without
+ *      mapping the frame, e.g. so a pager can write it to disk.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      None. The frame's access bits are not changed.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuReadFrame(frame, buffer)
+    int         frame;          /* Frame to read. */
+    void        *buffer;        /* USLOSS_MmuPageSize() bytes */
+{
+    ssize_t     result;
+
+    check_kernel_mode("USLOSS_MmuReadFrame");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((frame < 0) || (frame >= mmuPtr->numFrames)) {
+        return USLOSS_MMU_ERR_FRAME;
+    }
+    result = pread(mmuPtr->fd, buffer, mmuPageSize, FrameOffset(frame));
+    assert(result == mmuPageSize);
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuWriteFrame --
+ *
+ *      Copies a page-sized buffer straight into a frame without mapping
+ *      the frame, so a pager can fill the frame before mapping it into
+ *      the faulting process. Pages already mapped to the frame see the
+ *      new contents.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      The frame's contents are changed. Its access bits are not.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuWriteFrame(frame, buffer)
+    int         frame;          /* Frame to write. */
+    void        *buffer;        /* USLOSS_MmuPageSize() bytes */
+{
+    ssize_t     result;
+
+    check_kernel_mode("USLOSS_MmuWriteFrame");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((frame < 0) || (frame >= mmuPtr->numFrames)) {
+        return USLOSS_MMU_ERR_FRAME;
+    }
+    result = pwrite(mmuPtr->fd, buffer, mmuPageSize, FrameOffset(frame));
+    assert(result == mmuPageSize);
+    return USLOSS_MMU_OK;
+}
+#define PROTS(real, virt) (((real) << 16) | (virt))
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuHandler --
+ *
+ *      Called when a segmentation violation occurs. This routine determines
+ *      if it's a page fault, access violation, a change in the access
+ *      bits, a TLB miss, or a real segmentation violation.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Unmaps the frame
+ *
+ *----------------------------------------------------------------------
+ */
+void
+USLOSS_MmuHandler(sig, siginfoPtr, contextPtr)
+    int         sig;            /* Which signal happened. */
+    siginfo_t   *siginfoPtr;    /* Signal information. */
+    ucontext_t  *contextPtr;    /* Unused. */
+
+{
+    int         page;
+    int         interrupt = 0;
+    MMUPage     *pagePtr;
+    int         frame;
+    int         prot;
+    int         old_psr = current_psr;
+    int         result;
+
+    assert(siginfoPtr != NULL);
+    assert(sig == SIGSEGV || sig == SIGBUS);
+    debug("USLOSS_MmuHandler: address 0x%p, psr 0x%x\n", siginfoPtr->si_addr,
+        current_psr);
+    page = PageIndex(siginfoPtr->si_addr);
+    if (mmuInTouch) {
+        debug("USLOSS_MmuHandler: address 0x%p touched\n", siginfoPtr->si_addr);
+        goto done;
+    }
+    /*
+     * If the MMU isn't initialized, or the page is invalid, let the
+     * default handler handle it.
+     */
+    if ((mmuPtr == NULL) || (page < 0) || (page >= mmuPtr->numPages)) {
+        result = sigaction(SIGSEGV, &old_actions[SIGSEGV], NULL);
+        usloss_sys_assert(result != -1, "error setting SIGSEGV action");
+        result = sigaction(SIGBUS, &old_actions[SIGBUS], NULL);
+        usloss_sys_assert(result != -1, "error setting SIGBUS action");
+        debug("USLOSS_MmuHandler: real segv (0x%p, %d)!!\n", mmuPtr, page);
+        goto done;
+    }
+    mmuPtr->stats.faults++;
+    /*
+     * If the TAG is -1 or the page isn't mapped (frame is -1) 
+     * then it's an MMU fault.
+     */
+    if ((mmuPtr->tag == -1) || (mmuPtr->pages[mmuPtr->tag] == NULL) ||
+        (mmuPtr->pages[mmuPtr->tag][page].frame == -1)) {
+        mmuPtr->cause = USLOSS_MMU_FAULT;
+        interrupt = 1;
+        goto done;
+    }
+    pagePtr = &mmuPtr->pages[mmuPtr->tag][page];
+    frame = pagePtr->frame;
+    /*
+     * A page that isn't in the TLB has no real access. Load it and, if
+     * the kernel wants to know about misses, let the access fault again
+     * once the interrupt handler returns.
+     */
+    if (mmuPtr->tlb != NULL) {
+        if (pagePtr->tlb != -1) {
+            mmuPtr->stats.tlbHits++;
+            if ((mmuPtr->tlbFlags & ~USLOSS_MMU_TLB_MISS_INT) == 
+                USLOSS_MMU_TLB_LRU) {
+                mmuPtr->tlb[pagePtr->tlb].stamp = ++mmuPtr->tlbClock;
+            }
+        } else {
+            mmuPtr->stats.tlbMisses++;
+            TlbLoad(page);
+            if (mmuPtr->tlbFlags & USLOSS_MMU_TLB_MISS_INT) {
+                mmuPtr->cause = USLOSS_MMU_TLB_MISS;
+                interrupt = 1;
+                goto done;
+            }
+        }
+    }
+    assert((pagePtr->realProt & (~PROT_RW)) == 0);
+    assert((pagePtr->virtProt & (~USLOSS_MMU_PROT_RW)) == 0);
+    /*
+     * Access violations are harder to handle. What we do depends on the
+     * virtual protection and real protection of the page. There are nine
+     * different combintations: three are access violations, three require
+     * the access bits to be updated, and three can't happen.
+     */
+    debug("USLOSS_MmuHandler: <%d,%d>\n", pagePtr->realProt, pagePtr->virtProt);
+    switch(PROTS(pagePtr->realProt, pagePtr->virtProt)) {
+        case PROTS(PROT_NONE,   USLOSS_MMU_PROT_NONE):
+        case PROTS(PROT_READ,   USLOSS_MMU_PROT_READ):
+        case PROTS(PROT_RW,     USLOSS_MMU_PROT_RW):
+            debug("USLOSS_MmuHandler: access violation\n");
+            mmuPtr->cause = USLOSS_MMU_ACCESS;
+            interrupt = 1;
+            break;
+        case PROTS(PROT_READ,   USLOSS_MMU_PROT_RW):
+            debug("USLOSS_MmuHandler: setting dirty bit\n");
+            SetRealProt(page, PROT_RW);
+            MarkAccess(frame, USLOSS_MMU_REF|USLOSS_MMU_DIRTY);
+            break;
+        case PROTS(PROT_NONE,   USLOSS_MMU_PROT_READ):
+        case PROTS(PROT_NONE,   USLOSS_MMU_PROT_RW):
+            /*
+             * Either the reference bit was cleared or the page hasn't been
+             * mapped in since its tag became current. A frame that is
+             * already dirty doesn't need to catch the write.
+             */
+            debug("USLOSS_MmuHandler: setting ref bit\n");
+            if (mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) {
+                prot = MapProt(pagePtr->virtProt);
+            } else if ((pagePtr->virtProt == USLOSS_MMU_PROT_RW) &&
+                       (FrameAccess(frame) & USLOSS_MMU_DIRTY)) {
+                prot = PROT_RW;
+            } else {
+                prot = PROT_READ;
+            }
+            HarvestBegin(mmuPtr->tag, page, 1);
+            SetRealProt(page, prot);
+            HarvestEnd();
+            MarkAccess(frame, USLOSS_MMU_REF);
+            break;
+        case PROTS(PROT_READ,   USLOSS_MMU_PROT_NONE):
+        case PROTS(PROT_RW,     USLOSS_MMU_PROT_NONE):
+        case PROTS(PROT_RW,     USLOSS_MMU_PROT_READ):
+        default:
+            fprintf(stderr, 
+                "USLOSS: Internal error in USLOSS_MmuHandler\n");
+            abort();
+            break;
+    }
+done:
+    if (mmuPtr != NULL) {
+        debug("USLOSS_MmuHandler: addr 0x%p, cause %d\n", siginfoPtr->si_addr, 
+            mmuPtr->cause);
+        if (interrupt) {
+            if (int_vec[MMU_INT] == NULL) {
+                rpt_sim_trap("USLOSS int_vec[MMU_INT] is NULL!\n");
+            }
+            (*int_vec[MMU_INT])(MMU_INT,
+                (void *) (siginfoPtr->si_addr - mmuPtr->region));
+        }
+    }
+    current_psr = old_psr;
+}
+/*
+ *----------------------------------------------------------------------
+ *
+ * debug
+ *
+ *      Prints debugging output to the USLOSS_Console if the debugging flag
+ *      is set.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+void debug(char *fmt, ...)
+{
+    va_list ap;
+
+    if (debugging) {
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        fflush(stderr);
+        va_end(ap);
+    }
+}
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetRealProt
+ *
+ *      Sets the real protection on a page and updates the page information
+ *      accordingly.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SetRealProt(page, prot)
+    int         page;           /* Page to change. */
+    int         prot;           /* New protection for page. */
+{
+#ifdef MMU_VALIDATE
+    int         i;
+#endif
+
+    SetTagProt(mmuPtr->tag, page, prot);
+#ifdef MMU_VALIDATE
+    for (i = 0; i < mmuPtr->numPages; i++) {
+        if (mmuPtr->pages[mmuPtr->tag][i].frame == -1) {
+            assert(USLOSS_MmuTouch(PageAddr(i)) == FALSE);
+        }
+    }
+#endif
+}
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetTagProt
+ *
+ *      Sets the real protection on a page of the given tag, which must
+ *      either be the current tag or have its mappings in a shadow region.
+ *      A page of a large page sets the protection of the whole large page.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The page is remapped.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+SetTagProt(tag, page, prot)
+    int         tag;            /* Tag of the page. */
+    int         page;           /* Page to change. */
+    int         prot;           /* New protection for page. */
+{
+    MMUPage     *pagePtr;
+    void        *pageAddr;
+    void        *addr;
+    int         count = 1;
+    int         i;
+
+    pagePtr = &mmuPtr->pages[tag][page];
+    if (pagePtr->large) {
+        page = LargeHead(page);
+        pagePtr = &mmuPtr->pages[tag][page];
+        count = mmuPtr->largePages;
+    }
+    pageAddr = TagPageAddr(tag, page);
+    assert(pagePtr->frame != -1);
+    assert(pageAddr != NULL);
+    debug("SetTagProt:  tag %d page %d (0x%p) real prot was %d is %d\n", tag,
+        page, pageAddr, pagePtr->realProt, prot);
+    for (i = 0; i < count; i++) {
+        pagePtr[i].realProt = prot;
+    }
+    addr = mmap(pageAddr, count * mmuPageSize, prot, 
+            MAP_SHARED|MAP_FIXED, mmuPtr->fd, 
+            FrameOffset(pagePtr->frame));
+    assert(addr != MAP_FAILED);
+    assert(addr == pageAddr);
+    debug("SetTagProt: 0x%x -> 0x%x (0x%x)\n", pageAddr,
+        FrameOffset(pagePtr->frame), prot);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RevInsert
+ *
+ *      Adds a newly mapped page to its frame's reverse map.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The frame's list is changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RevInsert(tag, page)
+    int         tag;            /* Tag of the page. */
+    int         page;           /* Page number. */
+{
+    MMUPage     *pagePtr = &mmuPtr->pages[tag][page];
+    MMUFrame    *framePtr = &mmuPtr->frames[pagePtr->frame];
+    int         ref = PageRef(tag, page);
+
+    pagePtr->prev = -1;
+    pagePtr->next = framePtr->head;
+    if (framePtr->head != -1) {
+        RefPtr(framePtr->head)->prev = ref;
+    }
+    framePtr->head = ref;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RevRemove
+ *
+ *      Removes a page that is about to be unmapped from its frame's
+ *      reverse map.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The frame's list is changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RevRemove(tag, page)
+    int         tag;            /* Tag of the page. */
+    int         page;           /* Page number. */
+{
+    MMUPage     *pagePtr = &mmuPtr->pages[tag][page];
+    MMUFrame    *framePtr = &mmuPtr->frames[pagePtr->frame];
+
+    if (pagePtr->prev == -1) {
+        framePtr->head = pagePtr->next;
+    } else {
+        RefPtr(pagePtr->prev)->next = pagePtr->next;
+    }
+    if (pagePtr->next != -1) {
+        RefPtr(pagePtr->next)->prev = pagePtr->prev;
+    }
+    pagePtr->next = pagePtr->prev = -1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FrameAccess
+ *
+ *      Returns the access bits of a frame. The frames of a large page
+ *      share theirs.
+ *
+ * Results:
+ *      The access bits.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FrameAccess(frame)
+    int         frame;          /* Frame number. */
+{
+    int         access = 0;
+    int         first;
+    int         i;
+
+    if (mmuPtr->frames[frame].large == 0) {
+        return mmuPtr->frames[frame].access;
+    }
+    first = LargeHead(frame);
+    for (i = first; i < first + mmuPtr->largePages; i++) {
+        access |= mmuPtr->frames[i].access;
+    }
+    return access;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MarkAccess
+ *
+ *      Sets access bits of a frame, or of all frames of its large page.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Frame access bits are set.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MarkAccess(frame, access)
+    int         frame;          /* Frame number. */
+    int         access;         /* Access bits to set. */
+{
+    int         first;
+    int         i;
+
+    if (mmuPtr->frames[frame].large == 0) {
+        mmuPtr->frames[frame].access |= access;
+        return;
+    }
+    first = LargeHead(frame);
+    for (i = first; i < first + mmuPtr->largePages; i++) {
+        mmuPtr->frames[i].access |= access;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LargeRange
+ *
+ *      Widens a range of pages so that it doesn't split a large page.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      *pagePtr and *countPtr may be changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LargeRange(tag, pagePtr, countPtr)
+    int         tag;            /* Tag of the pages. */
+    int         *pagePtr;       /* First page of the range. */
+    int         *countPtr;      /* # of pages in the range. */
+{
+    int         first = *pagePtr;
+    int         last = *pagePtr + *countPtr - 1;
+
+    if (mmuPtr->largePages == 0) {
+        return;
+    }
+    if (mmuPtr->pages[tag][first].large) {
+        first = LargeHead(first);
+    }
+    if (mmuPtr->pages[tag][last].large) {
+        last = LargeHead(last) + mmuPtr->largePages - 1;
+    }
+    *pagePtr = first;
+    *countPtr = last - first + 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TlbLoad
+ *
+ *      Loads a page of the current tag into the TLB. The page goes into
+ *      a free entry of its set if there is one, otherwise into the entry
+ *      chosen by the replacement policy.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Another page may be evicted from the TLB.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TlbLoad(page)
+    int         page;           /* Page number. */
+{
+    MMUTlbEntry *tlb = mmuPtr->tlb;
+    int         first;
+    int         victim = -1;
+    int         i;
+
+    first = (page % (mmuPtr->tlbEntries / mmuPtr->tlbWays)) * 
+                mmuPtr->tlbWays;
+    for (i = first; i < first + mmuPtr->tlbWays; i++) {
+        if (tlb[i].ref == -1) {
+            victim = i;
+            break;
+        }
+        if ((victim == -1) || (tlb[i].stamp < tlb[victim].stamp)) {
+            victim = i;
+        }
+    }
+    if (tlb[victim].ref != -1) {
+        if ((mmuPtr->tlbFlags & ~USLOSS_MMU_TLB_MISS_INT) == 
+            USLOSS_MMU_TLB_RANDOM) {
+            mmuPtr->tlbSeed = mmuPtr->tlbSeed * 1103515245 + 12345;
+            victim = first + ((mmuPtr->tlbSeed >> 16) % mmuPtr->tlbWays);
+        }
+        mmuPtr->stats.tlbEvictions++;
+        TlbEvict(victim);
+    }
+    tlb[victim].ref = PageRef(mmuPtr->tag, page);
+    tlb[victim].stamp = ++mmuPtr->tlbClock;
+    mmuPtr->pages[mmuPtr->tag][page].tlb = victim;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TlbEvict
+ *
+ *      Invalidates a TLB entry. Its page loses any real access it had.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The page may be remapped.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TlbEvict(entry)
+    int         entry;          /* TLB entry. */
+{
+    int         ref = mmuPtr->tlb[entry].ref;
+    MMUPage     *pagePtr = RefPtr(ref);
+
+    TlbRemove(pagePtr);
+    if ((RefTag(ref) == mmuPtr->tag) && (pagePtr->realProt != PROT_NONE)) {
+        SetTagProt(RefTag(ref), RefPage(ref), PROT_NONE);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TlbRemove
+ *
+ *      Takes a page that is about to be unmapped, or that is being
+ *      evicted, out of the TLB.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The page's TLB entry, if any, is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TlbRemove(pagePtr)
+    MMUPage     *pagePtr;       /* Page to remove. */
+{
+    if (pagePtr->tlb != -1) {
+        mmuPtr->tlb[pagePtr->tlb].ref = -1;
+        pagePtr->tlb = -1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TagPageAddr
+ *
+ *      Returns the host address at which a page of the given tag is
+ *      currently mapped.
+ *
+ * Results:
+ *      The address in the vm region for the current tag, the address in
+ *      the tag's shadow region in prebuilt mode, NULL otherwise.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void *
+TagPageAddr(tag, page)
+    int         tag;            /* Tag of the page. */
+    int         page;           /* Page number. */
+{
+    if (tag == mmuPtr->tag) {
+        return PageAddr(page);
+    }
+    if (mmuPtr->mode & USLOSS_MMU_MODE_PREBUILT) {
+        return Shadow(tag) + ((size_t) page * mmuPageSize);
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PageTable
+ *
+ *      Returns the page table of the given tag, allocating it if this
+ *      is the first time the tag is used.
+ *
+ * Results:
+ *      The tag's page table.
+ *
+ * Side effects:
+ *      Memory may be allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static MMUPage *
+PageTable(tag)
+    int         tag;            /* Tag whose page table is wanted. */
+{
+    MMUPage     *pagePtr;
+    int         i;
+
+    if (mmuPtr->pages[tag] == NULL) {
+        pagePtr = (MMUPage *) malloc(mmuPtr->numPages * sizeof(MMUPage));
+        usloss_sys_assert(pagePtr != NULL, "error allocating page table");
+        for (i = 0; i < mmuPtr->numPages; i++) {
+            pagePtr[i].frame = -1;
+            pagePtr[i].realProt = PROT_NONE;
+            pagePtr[i].virtProt = 0;
+            pagePtr[i].next = pagePtr[i].prev = -1;
+            pagePtr[i].tlb = -1;
+            pagePtr[i].large = FALSE;
+        }
+        mmuPtr->pages[tag] = pagePtr;
+    }
+    return mmuPtr->pages[tag];
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Shadow
+ *
+ *      Returns the shadow region of the given tag in prebuilt mode,
+ *      reserving it if this is the first time the tag is used.
+ *
+ * Results:
+ *      The address of the tag's shadow region.
+ *
+ * Side effects:
+ *      Address space may be reserved.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void *
+Shadow(tag)
+    int         tag;            /* Tag whose shadow is wanted, or -1. */
+{
+    if (mmuPtr->shadows[tag + 1] == NULL) {
+        mmuPtr->shadows[tag + 1] = Reserve(RegionSize());
+    }
+    return mmuPtr->shadows[tag + 1];
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SwapRegions
+ *
+ *      Moves the old tag's mappings out of the vm region into its shadow
+ *      region and moves the new tag's mappings in. This takes three host
+ *      calls regardless of the number of pages.
+ *
+ * Results:
+ *      USLOSS_MMU_OK, or USLOSS_MMU_ERR_MODE if the host can't move a
+ *      region made of several mappings, in which case nothing was
+ *      changed and prebuilt mode is turned off.
+ *
+ * Side effects:
+ *      The vm region is remapped.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SwapRegions(old, new)
+    int         old;            /* Current tag */
+    int         new;            /* New tag */
+{
+    void        *addr;
+
+    void        *oldShadow;
+    void        *newShadow;
+    MMUPage     *pagePtr;
+    int         tag;
+    int         page;
+
+    oldShadow = Shadow(old);
+    newShadow = Shadow(new);
+    addr = mremap(mmuPtr->region, RegionSize(), RegionSize(),
+            MREMAP_MAYMOVE|MREMAP_FIXED, oldShadow);
+    if (addr == MAP_FAILED) {
+        /*
+         * Older kernels can only move a single mapping. Fall back to
+         * mapping pages in lazily. The other tags lose their host
+         * mappings, so their pages have no real access any more.
+         */
+        assert((errno == EFAULT) || (errno == EINVAL));
+        debug("SwapRegions: mremap failed, prebuilt mode off\n");
+        mmuPtr->mode &= ~USLOSS_MMU_MODE_PREBUILT;
+        for (tag = 0; tag < mmuPtr->numTags; tag++) {
+            pagePtr = mmuPtr->pages[tag];
+            for (page = 0; (tag != old) && (pagePtr != NULL) && 
+                           (page < mmuPtr->numPages); page++) {
+                pagePtr[page].realProt = PROT_NONE;
+            }
+        }
+        return USLOSS_MMU_ERR_MODE;
+    }
+    addr = mremap(newShadow, RegionSize(), RegionSize(),
+            MREMAP_MAYMOVE|MREMAP_FIXED, mmuPtr->region);
+    assert(addr == mmuPtr->region);
+    addr = mmap(newShadow, RegionSize(), PROT_NONE,
+            MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+    assert(addr == newShadow);
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MapProt
+ *
+ *      Returns the real protection a page with the given virtual
+ *      protection gets when it is mapped into the host.
+ *
+ * Results:
+ *      PROT_NONE, so the first access sets the access bits, unless the
+ *      MMU is in harvest mode. Then reads are always allowed, and writes
+ *      are allowed if the host keeps soft-dirty bits.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+MapProt(virtProt)
+    int         virtProt;       /* Virtual protection of the page. */
+{
+    if (((mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) == 0) ||
+        (virtProt == USLOSS_MMU_PROT_NONE)) {
+        return PROT_NONE;
+    }
+    if ((virtProt == USLOSS_MMU_PROT_READ) || !mmuPtr->softDirty) {
+        return PROT_READ;
+    }
+    return PROT_RW;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SoftDirtyWorks
+ *
+ *      Checks that clearing the soft-dirty bits works and that a write
+ *      sets them again.
+ *
+ * Results:
+ *      TRUE if the host tracks writes with soft-dirty bits.
+ *
+ * Side effects:
+ *      The soft-dirty bits of the whole process are cleared.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SoftDirtyWorks(pagemap, clearRefs)
+    int         pagemap;        /* /proc/self/pagemap */
+    int         clearRefs;      /* /proc/self/clear_refs */
+{
+    volatile char       *page;
+    off_t               offset;
+    uint64_t            before = PM_SOFT_DIRTY;
+    uint64_t            after = 0;
+
+    page = mmap(NULL, mmuPageSize, PROT_RW, MAP_PRIVATE|MAP_ANONYMOUS, 
+                -1, 0);
+    assert(page != MAP_FAILED);
+    *page = 0;
+    offset = ((uintptr_t) page / mmuPageSize) * sizeof(uint64_t);
+    if (write(clearRefs, "4", 1) == 1) {
+        (void) pread(pagemap, &before, sizeof(before), offset);
+        *page = 1;
+        (void) pread(pagemap, &after, sizeof(after), offset);
+    }
+    (void) munmap((void *) page, mmuPageSize);
+    return ((before & PM_SOFT_DIRTY) == 0) && ((after & PM_SOFT_DIRTY) != 0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Harvest
  *
- *      Called when a segmentation violation occurs. This routine determines
- *      if it's a page fault, access violation, a change in the access
- *      bits, or a real segmentation violation.
+ *      Merges the host's record of accesses to count pages starting at
+ *      page into their frames' access bits. A page that is present in
+ *      the host page table has been referenced since its frame's
+ *      reference bit was last cleared, and if the host keeps soft-dirty
+ *      bits a soft-dirty page has been written. Only the vm region can
+ *      hold accesses that haven't been merged yet, so pages of other
+ *      tags are skipped.
  *
  * Results:
  *      None.
  *
  * Side effects:
- *      Unmaps the frame
+ *      Frame access bits may be set.
  *
  *----------------------------------------------------------------------
  */
-void
-USLOSS_MmuHandler(sig, siginfoPtr, contextPtr)
-    int         sig;            /* Which signal happened. */
-    siginfo_t   *siginfoPtr;    /* Signal information. */
-    ucontext_t  *contextPtr;    /* Unused. */
 
+static void
+Harvest(tag, page, count)
+    int         tag;            /* Tag of the pages. */
+    int         page;           /* First page. */
+    int         count;          /* # of pages. */
 {
-    int         page;
-    int         interrupt = 0;
+    off_t       offset;
+    ssize_t     result;
     MMUPage     *pagePtr;
-    int         frame;
-    int         old_psr = current_psr;
-    int         result;
+    uint64_t    entry;
+    int         i;
 
-    assert(siginfoPtr != NULL);
-    assert(sig == SIGSEGV || sig == SIGBUS);
-    debug("USLOSS_MmuHandler: address 0x%p, psr 0x%x\n", siginfoPtr->si_addr,
-        current_psr);
-    page = PageIndex(siginfoPtr->si_addr);
-    if (mmuInTouch) {
-        debug("USLOSS_MmuHandler: address 0x%p touched\n", siginfoPtr->si_addr);
-        goto done;
-    }
-    /*
-     * If the MMU isn't initialized, or the page is invalid, let the
-     * default handler handle it.
-     */
-    if ((mmuPtr == NULL) || (page < 0) || (page >= mmuPtr->numPages)) {
-        result = sigaction(SIGSEGV, &old_actions[SIGSEGV], NULL);
-        usloss_sys_assert(result != -1, "error setting SIGSEGV action");
-        result = sigaction(SIGBUS, &old_actions[SIGBUS], NULL);
-        usloss_sys_assert(result != -1, "error setting SIGBUS action");
-        debug("USLOSS_MmuHandler: real segv (0x%p, %d)!!\n", mmuPtr, page);
-        goto done;
-    }
-    /*
-     * If the TAG is -1 or the page isn't mapped (frame is -1) 
-     * then it's an MMU fault.
-     */
-    if ((mmuPtr->tag == -1) || 
-        (mmuPtr->pages[mmuPtr->tag][page].frame == -1)) {
-        mmuPtr->cause = USLOSS_MMU_FAULT;
-        interrupt = 1;
-        goto done;
-    }
-    pagePtr = &mmuPtr->pages[mmuPtr->tag][page];
-    frame = pagePtr->frame;
-    assert((pagePtr->realProt & (~PROT_RW)) == 0);
-    assert((pagePtr->virtProt & (~USLOSS_MMU_PROT_RW)) == 0);
-    /*
-     * Access violations are harder to handle. What we do depends on the
-     * virtual protection and real protection of the page. There are nine
-     * different combintations: three are access violations, three require
-     * the access bits to be updated, and three can't happen.
-     */
-    debug("USLOSS_MmuHandler: <%d,%d>\n", pagePtr->realProt, pagePtr->virtProt);
-    switch(PROTS(pagePtr->realProt, pagePtr->virtProt)) {
-        case PROTS(PROT_NONE,   USLOSS_MMU_PROT_NONE):
-        case PROTS(PROT_READ,   USLOSS_MMU_PROT_READ):
-        case PROTS(PROT_RW,     USLOSS_MMU_PROT_RW):
-            debug("USLOSS_MmuHandler: access violation\n");
-            mmuPtr->cause = USLOSS_MMU_ACCESS;
-            interrupt = 1;
-            break;
-        case PROTS(PROT_READ,   USLOSS_MMU_PROT_RW):
-            debug("USLOSS_MmuHandler: setting dirty bit\n");
-            SetRealProt(page, PROT_RW);
-            mmuPtr->frames[frame].access |= USLOSS_MMU_DIRTY;
-            break;
-        case PROTS(PROT_NONE,   USLOSS_MMU_PROT_READ):
-        case PROTS(PROT_NONE,   USLOSS_MMU_PROT_RW):
-            debug("USLOSS_MmuHandler: setting ref bit\n");
-            SetRealProt(page, PROT_READ);
-            mmuPtr->frames[frame].access |= USLOSS_MMU_REF;
-            break;
-        case PROTS(PROT_READ,   USLOSS_MMU_PROT_NONE):
-        case PROTS(PROT_RW,     USLOSS_MMU_PROT_NONE):
-        case PROTS(PROT_RW,     USLOSS_MMU_PROT_READ):
-        default:
-            fprintf(stderr, 
-                "USLOSS: Internal error in USLOSS_MmuHandler\n");
-            abort();
-            break;
+    if ((tag == -1) || (tag != mmuPtr->tag) || 
+        (mmuPtr->pages[tag] == NULL)) {
+        return;
     }
-done:
-    if (mmuPtr != NULL) {
-        debug("USLOSS_MmuHandler: addr 0x%p, cause %d\n", siginfoPtr->si_addr, 
-            mmuPtr->cause);
-        if (interrupt) {
-            if (int_vec[MMU_INT] == NULL) {
-                rpt_sim_trap("USLOSS int_vec[MMU_INT] is NULL!\n");
-            }
-            (*int_vec[MMU_INT])(MMU_INT,
-                (void *) (siginfoPtr->si_addr - mmuPtr->region));
+    offset = ((uintptr_t) PageAddr(page) / mmuPageSize) * sizeof(uint64_t);
+    result = pread(mmuPtr->pagemap, mmuPtr->entries, 
+                count * sizeof(uint64_t), offset);
+    assert(result == count * sizeof(uint64_t));
+    for (i = 0; i < count; i++) {
+        pagePtr = &mmuPtr->pages[tag][page + i];
+        if (pagePtr->frame == -1) {
+            continue;
+        }
+        entry = mmuPtr->entries[i];
+        if (entry & PM_PRESENT) {
+            mmuPtr->frames[pagePtr->frame].access |= USLOSS_MMU_REF;
+        }
+        if (mmuPtr->softDirty && (entry & PM_SOFT_DIRTY)) {
+            mmuPtr->frames[pagePtr->frame].access |= USLOSS_MMU_DIRTY;
         }
-        set_timer();
     }
-    current_psr = old_psr;
 }
+
 /*
  *----------------------------------------------------------------------
  *
- * debug
+ * HarvestBegin
  *
- *      Prints debugging output to the USLOSS_Console if the debugging flag
- *      is set.
+ *      Called in harvest mode before host mappings are replaced, so the
+ *      accesses recorded in them aren't lost. Replacing mappings makes
+ *      the host report every page around them as soft-dirty, so if
+ *      soft-dirty bits are used the whole region is harvested here and
+ *      HarvestEnd clears them all afterwards.
  *
  * Results:
  *      None.
  *
  * Side effects:
- *      None.
+ *      Frame access bits may be set.
  *
  *----------------------------------------------------------------------
  */
-void debug(char *fmt, ...)
-{
-    va_list ap;
 
-    if (debugging) {
-        va_start(ap, fmt);
-        vfprintf(stderr, fmt, ap);
-        fflush(stderr);
-        va_end(ap);
+static void
+HarvestBegin(tag, page, count)
+    int         tag;            /* Tag of the pages being remapped. */
+    int         page;           /* First page being remapped. */
+    int         count;          /* # of pages being remapped. */
+{
+    if ((mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) == 0) {
+        return;
+    }
+    if (mmuPtr->softDirty) {
+        Harvest(mmuPtr->tag, 0, mmuPtr->numPages);
+    } else {
+        Harvest(tag, page, count);
     }
 }
+
 /*
  *----------------------------------------------------------------------
  *
- * SetRealProt
+ * HarvestEnd
  *
- *      Sets the real protection on a page and updates the page information
- *      accordingly.
+ *      Called after host mappings were replaced. See HarvestBegin.
  *
  * Results:
  *      None.
  *
  * Side effects:
- *      None.
+ *      The soft-dirty bits of the whole process may be cleared.
  *
  *----------------------------------------------------------------------
  */
 
 static void
-SetRealProt(page, prot)
-    int         page;           /* Page to change. */
-    int         prot;           /* New protection for page. */
+HarvestEnd(void)
 {
-    int         i;
-    MMUPage     *pagePtr;
-    void        *addr;
+    ssize_t     result;
 
-    pagePtr = &mmuPtr->pages[mmuPtr->tag][page];
-    assert(pagePtr->frame != -1);
-    debug("SetRealProt:  page %d (0x%p) real prot was %d is %d\n", page, 
-        PageAddr(page), pagePtr->realProt, prot);
-    pagePtr->realProt = prot;
-    addr = mmap(PageAddr(page), mmuPageSize, prot, 
-            MAP_SHARED|MAP_FIXED, mmuPtr->fd, 
-            pagePtr->frame * mmuPageSize);
-    assert(addr != MAP_FAILED);
-    assert(addr == PageAddr(page));
-    debug("SetRealProt: 0x%x -> 0x%x (0x%x)\n", PageAddr(page),
-        pagePtr->frame * mmuPageSize, prot);
-    for (i = 0; i < mmuPtr->numPages; i++) {
-        if (mmuPtr->pages[mmuPtr->tag][i].frame == -1) {
-            assert(USLOSS_MmuTouch(PageAddr(i)) == FALSE);
-        }
+    if ((mmuPtr->mode & USLOSS_MMU_MODE_HARVEST) && mmuPtr->softDirty) {
+        result = write(mmuPtr->clearRefs, "4", 1);
+        assert(result == 1);
     }
 }
+
 /*
  *----------------------------------------------------------------------
  *
@@ -756,7 +2405,7 @@ USLOSS_MmuSetTag(new)
     if (mmuPtr == NULL) {
         return USLOSS_MMU_ERR_OFF;
     }
-    if ((new < 0) || (new >= USLOSS_MMU_NUM_TAG)) {
+    if ((new < 0) || (new >= mmuPtr->numTags)) {
         return USLOSS_MMU_ERR_TAG;
     }
     status = SetTag(new);
@@ -789,14 +2438,85 @@ USLOSS_MmuGetTag(tagPtr)
     return USLOSS_MMU_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuTlbFlush
+ *
+ *      Removes the pages of the given tag from the TLB, or all pages if
+ *      the tag is -1. The TLB is kept coherent with the page tables, so
+ *      this is only needed to model the cost of a flush, e.g. on every
+ *      tag switch for an untagged TLB.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      TLB entries are invalidated.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuTlbFlush(tag)
+    int         tag;            /* Tag to flush, or -1 for all. */
+{
+    int         i;
+
+    check_kernel_mode("USLOSS_MmuTlbFlush");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    if ((tag < -1) || (tag >= mmuPtr->numTags)) {
+        return USLOSS_MMU_ERR_TAG;
+    }
+    mmuPtr->stats.tlbFlushes++;
+    for (i = 0; i < mmuPtr->tlbEntries; i++) {
+        if ((mmuPtr->tlb[i].ref != -1) && 
+            ((tag == -1) || (RefTag(mmuPtr->tlb[i].ref) == tag))) {
+            TlbEvict(i);
+        }
+    }
+    return USLOSS_MMU_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * USLOSS_MmuGetStats
+ *
+ *      Returns the MMU statistics since USLOSS_MmuInit.
+ *
+ * Results:
+ *      MMU return status.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+USLOSS_MmuGetStats(statsPtr)
+    USLOSS_MmuStats *statsPtr;  /* Place to store the statistics */
+{
+    check_kernel_mode("USLOSS_MmuGetStats");
+    if (mmuPtr == NULL) {
+        return USLOSS_MMU_ERR_OFF;
+    }
+    *statsPtr = mmuPtr->stats;
+    return USLOSS_MMU_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
  * SetTag
  *
  *      Sets the current tag in the MMU. If the tag has changed then
- *      all pages associated with the old tag are unmapped, and all
- *      pages associated with the new tag are mapped.
+ *      all pages associated with the old tag are unmapped with a single
+ *      host call. The pages associated with the new tag are mapped in
+ *      by the faults on their first accesses, so a switch only pays for
+ *      the pages that are touched. In prebuilt mode the two tags' regions
+ *      are swapped instead.
  *
  *      This routine is not intended to be called outside of usloss.
  *      See USLOSS_MmuSetTag for an external routine.
@@ -816,6 +2536,7 @@ SetTag(new)
     int         old;
     int         page;
     char        *addr;
+    MMUPage     *pagePtr;
 
     /*
      * Note that new can be -1, which is what usloss will set it to
@@ -826,35 +2547,34 @@ SetTag(new)
 
     check_kernel_mode("SetTag");
     debug("SetTag: %d\n", new);
-    if ((new < -1) || (new >= USLOSS_MMU_NUM_TAG)) {
-        return USLOSS_MMU_ERR_TAG;
-    }
     if (mmuPtr == NULL) {
         return USLOSS_MMU_ERR_OFF;
     }
+    if ((new < -1) || (new >= mmuPtr->numTags)) {
+        return USLOSS_MMU_ERR_TAG;
+    }
     old = mmuPtr->tag;
     if (old == new) {
         return USLOSS_MMU_OK;
     }
-    if (old != -1) {
-        for (page = 0; page < mmuPtr->numPages; page++) {
-            if (mmuPtr->pages[old][page].frame != -1) {
-                SetRealProt(page, PROT_NONE);
-            }
-        }
+    HarvestBegin(old, 0, mmuPtr->numPages);
+    if ((mmuPtr->mode & USLOSS_MMU_MODE_PREBUILT) &&
+        (SwapRegions(old, new) == USLOSS_MMU_OK)) {
+        mmuPtr->tag = new;
+        HarvestEnd();
+        return USLOSS_MMU_OK;
     }
-    mmuPtr->tag = new;
-    if (new != -1) {
+    if ((old != -1) && (mmuPtr->pages[old] != NULL)) {
+        pagePtr = mmuPtr->pages[old];
         for (page = 0; page < mmuPtr->numPages; page++) {
-            if (mmuPtr->pages[new][page].frame != -1) {
-                addr = mmap(PageAddr(page), mmuPageSize, PROT_NONE, 
-                        MAP_SHARED|MAP_FIXED, mmuPtr->fd, 
-                        mmuPtr->pages[new][page].frame * mmuPageSize);
-                assert(addr != MAP_FAILED);
-                assert(addr == PageAddr(page));
-            }
+            pagePtr[page].realProt = PROT_NONE;
         }
+        addr = mmap(mmuPtr->region, RegionSize(), PROT_NONE, 
+                    MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED, -1, 0);
+        assert(addr == mmuPtr->region);
     }
+    mmuPtr->tag = new;
+    HarvestEnd();
     return USLOSS_MMU_OK;
 }
 
@@ -877,9 +2597,136 @@ SetTag(new)
 int
 USLOSS_MmuPageSize(void)
 {
+    int         mode;
+
+    mode = (mmuPtr != NULL) ? mmuPtr->mode : mmuMode;
+    if (mode & USLOSS_MMU_MODE_HUGE) {
+        return HugePageSize();
+    }
     return sysconf(_SC_PAGESIZE);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * HugePageSize
+ *
+ *      Returns the host's default huge page size.
+ *
+ * Results:
+ *      Number of bytes in a huge page, or -1 if the host has none.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+HugePageSize(void)
+{
+    static int  size = 0;
+    FILE        *stream;
+    char        line[128];
+    int         kb;
+
+    if (size == 0) {
+        size = -1;
+        stream = fopen("/proc/meminfo", "r");
+        while ((stream != NULL) && (fgets(line, sizeof(line), stream) != NULL)) {
+            if (sscanf(line, "Hugepagesize: %d kB", &kb) == 1) {
+                size = kb * 1024;
+                break;
+            }
+        }
+        if (stream != NULL) {
+            fclose(stream);
+        }
+    }
+    return size;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MemFile
+ *
+ *      Creates the file that holds physical memory. It lives in memory
+ *      rather than on disk when the host allows it.
+ *
+ * Results:
+ *      The file descriptor, or -1 if huge pages were asked for and
+ *      the host can't provide them.
+ *
+ * Side effects:
+ *      A file is created.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+MemFile(size, huge)
+    off_t       size;           /* Size of the file in bytes. */
+    int         huge;           /* Back the file with huge pages. */
+{
+    int         fd = -1;
+    FILE        *stream;
+
+#ifdef MFD_CLOEXEC
+    fd = memfd_create("usloss", MFD_CLOEXEC | (huge ? MFD_HUGETLB : 0));
+#endif
+    if (fd == -1) {
+        if (huge) {
+            return -1;
+        }
+        stream = tmpfile();
+        assert(stream != NULL);
+        fd = dup(fileno(stream));
+        assert(fd != -1);
+        fclose(stream);
+    }
+    if (ftruncate(fd, size) != 0) {
+        assert(huge);
+        (void) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Reserve
+ *
+ *      Reserves inaccessible address space aligned to the page size.
+ *
+ * Results:
+ *      The address of the reservation.
+ *
+ * Side effects:
+ *      Address space is mapped.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void *
+Reserve(size)
+    size_t      size;           /* Bytes to reserve. */
+{
+    char        *addr;
+    size_t      lead;
+
+    addr = mmap(NULL, size + mmuPageSize, PROT_NONE, 
+                MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    assert(addr != MAP_FAILED);
+    lead = (mmuPageSize - ((uintptr_t) addr % mmuPageSize)) % mmuPageSize;
+    if (lead > 0) {
+        (void) munmap(addr, lead);
+    }
+    (void) munmap(addr + lead + size, mmuPageSize - lead);
+    return addr + lead;
+}
+
 
 /*
  *----------------------------------------------------------------------
@@ -908,6 +2755,7 @@ USLOSS_MmuTouch(void *addr)
     debug("Touch 0x%p\n", addr);
     result = sigsetjmp(mmuTouchBuf, 1);
     if (result == 0) {
+        (void) *((volatile char *) addr);
         touched = TRUE;
     } else {
         touched = FALSE;
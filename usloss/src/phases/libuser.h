@@ -37,7 +37,20 @@ extern int  Mbox_CondSend(int mbox, int size, void *msg);
 extern int  Mbox_CondReceive(int mbox, int size, void *msg);
 
 /* Phase 5 -- User Function Prototypes */
+struct VmStats;
+struct VmProcStats;
+
 extern void *VmInit(int mappings, int pages, int frames, int pagers);
+extern void *VmInitPolicy(int mappings, int pages, int frames, int pagers,
+                          int policy);
 extern void VmCleanup(void);
+extern int  VmShare(int pid, int page, int count);
+extern int  VmCow(int pid, int page, int count);
+extern void *HeapAlloc(int pages);
+extern int  HeapFree(void *addr, int pages);
+extern void *Malloc(int size);
+extern void Free(void *ptr);
+extern int  VmGetStats(struct VmStats *stats);
+extern int  VmGetProcStats(int pid, struct VmProcStats *procStats);
 
 #endif
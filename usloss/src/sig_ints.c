@@ -20,6 +20,8 @@
 
 static void             *syscall_arg = NULL;
 static int              syscall_pending = 0;
+static volatile int     int_shadow = 0;
+static volatile int     alarm_held = 0;
 struct sigaction        old_actions[NUM_SIG];
 
 static context           *launch_context;
@@ -130,6 +132,12 @@ static void sighandler(int sig, siginfo_t *sigstuff, void *oldcontext)
     switch(sig)
     {
       case SIG_ALARM:   /*  Device or clock interrupt - to dispatch routine */
+        if (int_shadow) {
+            int_shadow = 0;
+            alarm_held = 1;
+            goto done;
+        }
+        alarm_held = 0;
         waiting = 0;    /*  or make this conditional depending on terminal? */
         pclock_ticks++;
         partial_ticks = 0;
@@ -226,6 +234,7 @@ int int_off(void)
 
     err_return = sigprocmask(SIG_BLOCK, &timer_set, &cur_set);
     usloss_sys_assert(err_return != -1, "error disabling interrupts");
+    int_shadow = 0;
     enabled = sigismember(&cur_set, SIG_ALARM) ? FALSE : TRUE;
     return enabled;
 }
@@ -242,13 +251,34 @@ int int_off(void)
 void int_on(void) 
 {
     int err_return;
+    int shadowed;
     sigset_t cur_set;
 
+    shadowed = int_shadow;
     err_return = sigprocmask(SIG_UNBLOCK, &timer_set, NULL);
     usloss_sys_assert(err_return != -1, "error enabling interrupts");
     err_return = sigprocmask(SIG_BLOCK, NULL, &cur_set);
     usloss_sys_assert(err_return != -1, "error checking signals");
     usloss_sys_assert(sigismember(&cur_set, SIGUSR1) == 0, "SIGUSR1 is blocked");
+    if (alarm_held && !shadowed) {
+        alarm_held = 0;
+        raise(SIG_ALARM);
+    }
+}
+
+/*
+ *  Enables interrupts for kernel code, but holds back the first SIG_ALARM
+ *  until the next USLOSS operation, much as x86 does not take interrupts
+ *  in the instruction after sti. A dispatcher that enables interrupts and
+ *  then calls context_switch takes that interrupt in the new context. If
+ *  the interrupt arrived in between, the handler would run with the old
+ *  stack still live. If it then switched processes, it would save that
+ *  stack as the context of the process that was about to run.
+ */
+void int_on_shadowed(void)
+{
+    int_shadow = 1;
+    int_on();
 }
 
 
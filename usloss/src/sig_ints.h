@@ -8,6 +8,7 @@ dynamic_dcl void set_timer(void);
 dynamic_dcl void sig_ints_init(void);
 dynamic_dcl int int_off(void);
 dynamic_dcl void int_on(void);
+dynamic_dcl void int_on_shadowed(void);
 
 #endif	/*  _sig_ints_h */
 
@@ -74,7 +74,7 @@ extern void (*int_vec[NUM_INTS])(int dev, void *arg);
  */
 
 #define CLOCK_UNITS	1
-#define ALARM_UNITS	1
+#define ALARM_UNITS	4
 #define DISK_UNITS	2
 #define TERM_UNITS	4
 /*
@@ -101,6 +101,7 @@ typedef struct device_request
 #define DISK_WRITE	1
 #define DISK_SEEK	2
 #define DISK_TRACKS	3
+#define DISK_STATS	4	/* reg1/reg2 -> int: cache hits/misses */
 
 /*
  *  These are the status codes returned by device_output(). In general,
@@ -156,6 +157,69 @@ typedef struct device_request
 #define TERM_CTRL_XMIT_CHAR(ctrl)\
 	((ctrl) | 0x1)			/* xmit the char in the upper bits */
 
+/*
+ * Block-transfer mode. Each terminal unit also has a block port,
+ * addressed as TERM_BLOCK_UNIT(unit). Passing a device_request to the
+ * block port starts a transfer: opr is TERM_XMIT_BLOCK or
+ * TERM_RECV_BLOCK, reg1 is the buffer and reg2 is the length (at most
+ * TERM_BLOCK_MAX). A receive completes on a newline or when the buffer
+ * is full. Each completed transfer raises a single TERM_INT whose unit
+ * argument is the block port; device_input on the block port returns
+ * the block status below, and reading it clears the done bits.
+ */
+#define TERM_BLOCK_FLAG		0x10
+#define TERM_BLOCK_UNIT(unit)	((unit) | TERM_BLOCK_FLAG)
+#define TERM_UNIT(unit)		((unit) & ~TERM_BLOCK_FLAG)
+#define TERM_IS_BLOCK(unit)	(((unit) & TERM_BLOCK_FLAG) != 0)
+
+#define TERM_XMIT_BLOCK		0	/* transmit reg2 bytes from reg1 */
+#define TERM_RECV_BLOCK		1	/* receive up to reg2 bytes into reg1 */
+
+#define TERM_BLOCK_MAX		4095	/* largest block transfer */
+
+/*
+ * Block status fields. TERM_STAT_XMIT and TERM_STAT_RECV give the state
+ * of each direction (DEV_BUSY while a transfer is in progress).
+ */
+#define TERM_BLOCK_XMIT_DONE	0x10	/* xmit transfer completed */
+#define TERM_BLOCK_RECV_DONE	0x20	/* recv transfer completed */
+
+#define TERM_BLOCK_XMIT_COUNT(status)\
+	(((status) >> 8) & 0xfff)	/* bytes transmitted */
+
+#define TERM_BLOCK_RECV_COUNT(status)\
+	(((unsigned int) (status) >> 20) & 0xfff) /* bytes received */
+
+
+/*
+ * Clock control words, passed as the argument to device_output. The
+ * clock starts out periodic. CLOCK_CTRL_NEXT puts it in tickless mode
+ * and programs a single clock interrupt that many microseconds of
+ * virtual time from now; CLOCK_CTRL_IDLE puts it in tickless mode with
+ * no interrupt pending; CLOCK_CTRL_PERIODIC restores periodic ticks.
+ */
+#define CLOCK_NEXT_FLAG		0x40000000
+#define CLOCK_CTRL_PERIODIC	0
+#define CLOCK_CTRL_IDLE		(-1)
+#define CLOCK_CTRL_NEXT(usec)	(CLOCK_NEXT_FLAG | ((usec) & 0x3fffffff))
+
+/*
+ * Alarm control words, passed as the argument to device_output. A plain
+ * non-negative value arms the unit to go off that many clock ticks from
+ * now; ALARM_CTRL_USEC arms it with a delay in microseconds of virtual
+ * time; ALARM_CTRL_CANCEL disarms it. Each unit raises ALARM_INT with
+ * its unit number when it goes off.
+ */
+#define ALARM_USEC_FLAG		0x40000000
+#define ALARM_CTRL_USEC(usec)	(ALARM_USEC_FLAG | ((usec) & 0x3fffffff))
+#define ALARM_CTRL_CANCEL	(-1)
+
+/*
+ * Fields of the alarm status register: DEV_BUSY if armed, and the
+ * microseconds left before it goes off (saturating at 0xffffff).
+ */
+#define ALARM_STAT_STATE(status)	((status) & 0xff)
+#define ALARM_STAT_REMAINING(status)	(((unsigned int) (status) >> 8) & 0xffffff)
 
 /*
  *  Size of disk sector (in bytes) and number of sectors in a track
@@ -203,7 +267,9 @@ extern void finish(void);
  * MMU definitions.
  */
 
- #define USLOSS_MMU_NUM_TAG	4	/* Maximum number of tags in MMU */
+ #define USLOSS_MMU_NUM_TAG	4	/* Default number of tags in MMU */
+ #define USLOSS_MMU_MAX_TAG	1024	/* Most tags USLOSS_MmuSetNumTags
+					 * allows */
 
 /*
  * Error codes
@@ -219,6 +285,41 @@ extern void finish(void);
 #define USLOSS_MMU_ERR_NOMAP	8	/* Page not mapped */
 #define USLOSS_MMU_ERR_ACC	9	/* Invalid access bits */
 #define USLOSS_MMU_ERR_MAPS	10	/* Too many mappings */
+#define USLOSS_MMU_ERR_MODE	11	/* Invalid or unsupported mode */
+
+/*
+ * Modes, selected with USLOSS_MmuSetMode before USLOSS_MmuInit
+ */
+#define USLOSS_MMU_MODE_PREBUILT	0x1	/* Keep per-tag host mappings so a
+						 * tag switch is O(1) */
+#define USLOSS_MMU_MODE_HARVEST		0x2	/* Collect the access bits from the
+						 * host page tables instead of
+						 * faulting on first access */
+#define USLOSS_MMU_MODE_HUGE		0x4	/* Back frames with huge pages;
+						 * USLOSS_MmuPageSize becomes the
+						 * huge page size */
+
+/*
+ * TLB replacement policies and flags, for USLOSS_MmuSetTlb
+ */
+#define USLOSS_MMU_TLB_LRU	0	/* Least recently used entry */
+#define USLOSS_MMU_TLB_FIFO	1	/* Oldest entry */
+#define USLOSS_MMU_TLB_RANDOM	2	/* Any entry */
+#define USLOSS_MMU_TLB_MISS_INT	0x10	/* Raise MMU_INT on every TLB miss */
+
+/*
+ * Statistics, returned by USLOSS_MmuGetStats. A TLB hit is only seen
+ * when it faults for another reason (e.g. to set the access bits), so
+ * tlbHits is a lower bound.
+ */
+typedef struct USLOSS_MmuStats {
+    int		tlbHits;	/* TLB hits seen by the MMU */
+    int		tlbMisses;	/* TLB misses on mapped pages */
+    int		tlbEvictions;	/* Entries replaced by a miss */
+    int		tlbFlushes;	/* Calls to USLOSS_MmuTlbFlush */
+    int		faults;		/* Host faults taken by the MMU, including
+				 * ones that only set access bits */
+} USLOSS_MmuStats;
 
 /*
  * Protections
@@ -232,6 +333,8 @@ extern void finish(void);
  */
 #define USLOSS_MMU_FAULT	1	/* Address was in unmapped page */
 #define USLOSS_MMU_ACCESS	2	/* Access type not permitted on page */
+#define USLOSS_MMU_TLB_MISS	3	/* Page not in the TLB; only reported
+					 * with USLOSS_MMU_TLB_MISS_INT */
 
 /*
  * Access bits
@@ -243,17 +346,32 @@ extern void finish(void);
  * Function prototypes for MMU routines. See the MMU documentation.
  */
 
+extern int	USLOSS_MmuSetMode(int mode);
+extern int	USLOSS_MmuSetNumTags(int numTags);
+extern int	USLOSS_MmuSetTlb(int entries, int ways, int flags);
+extern int	USLOSS_MmuSetLargePage(int pages);
 extern int 	USLOSS_MmuInit(int numMaps, int numPages, int numFrames);
 extern void	*USLOSS_MmuRegion(int *numPagesPtr);
 extern int	USLOSS_MmuDone(void);
 extern int	USLOSS_MmuMap(int tag, int page, int frame, int protection);
 extern int	USLOSS_MmuUnmap(int tag, int page);
+extern int	USLOSS_MmuMapRange(int tag, int page, int frame, int count,
+		    int protection);
+extern int	USLOSS_MmuUnmapRange(int tag, int page, int count);
+extern int	USLOSS_MmuMapLarge(int tag, int page, int frame, int protection);
+extern int	USLOSS_MmuProtectRange(int tag, int page, int count,
+		    int protection);
 extern int	USLOSS_MmuGetMap(int tag, int page, int *framePtr, int *protPtr);
 extern int	USLOSS_MmuGetCause(void);
 extern int	USLOSS_MmuSetAccess(int frame, int access);
 extern int	USLOSS_MmuGetAccess(int frame, int *accessPtr);
+extern int	USLOSS_MmuHarvestAccess(int *frames, int *bits, int count);
+extern int	USLOSS_MmuReadFrame(int frame, void *buffer);
+extern int	USLOSS_MmuWriteFrame(int frame, void *buffer);
 extern int	USLOSS_MmuSetTag(int tag);
 extern int	USLOSS_MmuGetTag(int *tagPtr);
+extern int	USLOSS_MmuTlbFlush(int tag);
+extern int	USLOSS_MmuGetStats(USLOSS_MmuStats *statsPtr);
 extern int	USLOSS_MmuPageSize(void);
 extern int	USLOSS_MmuTouch(void *addr);
 
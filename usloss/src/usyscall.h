@@ -35,11 +35,13 @@
 #define SYS_PROTECT		28
 #define SYS_SHARE		29
 #define SYS_COW			30
+#define SYS_VMSTATS		31
+#define SYS_VMPROCSTATS		32
 #endif
 
 // Leave some room for growth
 
-#define USLOSS_MAX_SYSCALLS	30	
+#define USLOSS_MAX_SYSCALLS	32	
 
 
 /*  The USLOSS_Sysargs structure */